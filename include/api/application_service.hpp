@@ -5,8 +5,10 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <span>
 
 #include "report_loader.hpp"
+#include "extraction_cache.hpp"
 #include "xml_generator.hpp"
 
 enum class TaxFormType {
@@ -17,6 +19,9 @@ enum class TaxFormType {
 
 struct GenerationRequest {
     std::filesystem::path inputFile;
+    // Input bytes already in memory (e.g. an upload spool), read instead of inputFile.
+    // inputFile still names the input and selects the format by its extension
+    std::optional<std::span<const std::byte>> inputData;
     std::filesystem::path outputDirectory;
     bool jsonOnly = false;
     
@@ -32,6 +37,16 @@ struct GenerationRequest {
     std::optional<std::string> taxpayerName;
     std::optional<std::string> address;
     std::optional<std::string> birthDate;
+
+    // Extracted text above this size is kept in a temporary file instead of memory
+    size_t memoryBudgetBytes = ReportLoader::DEFAULT_MEMORY_BUDGET_BYTES;
+
+    // Reuse text extracted from the same PDF in earlier runs, disabled when not set
+    std::optional<std::filesystem::path> cacheDirectory;
+    std::uintmax_t cacheMaxBytes = ExtractionCache::DEFAULT_MAX_BYTES;
+
+    // Grammar file with report wording that differs from the built-in one, see ReportGrammar
+    std::optional<std::filesystem::path> grammarFile;
 };
 
 struct GenerationResult {
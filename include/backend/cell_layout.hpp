@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Text of ReportLoader::TextLayout::Cells pages: lines rebuilt from positioned words, with the table cells of a line
+// separated by SEPARATOR. The validators check a single cell by the rules the line grammars apply to whole lines.
+namespace cell_layout {
+    constexpr char SEPARATOR = '\t';
+    constexpr double GAP_CHARS = 1.5; // Horizontal gap between words, in character widths, that starts a new cell
+
+    // Word box on a page, y grows downwards
+    struct Word {
+        std::string mText;
+        double mLeft;
+        double mRight;
+        double mCenterY;
+        double mHeight;
+        double mCharWidth;
+    };
+
+    // Words on the same baseline form a line, a wide horizontal gap starts a new cell and vertical gaps become
+    // empty lines, so the line structure matches the flat text. Ends with a '\f' page break like page::text()
+    std::string layoutPage(std::vector<Word> aWords);
+
+    std::vector<std::string_view> splitCells(std::string_view aLine); // Empty for flat text lines
+    bool isDate(std::string_view aCell);                              // DD.MM.YYYY
+    bool isGroupedNumber(std::string_view aCell);                     // -?\d{1,3}(?:,\d{3})*(?:\.\d+)?
+    bool isLooseNumber(std::string_view aCell, bool aSigned);         // -?[\d\.,]+ with aSigned, else [\d\.,]+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// On-disk cache of the per-page text extracted from PDFs.
+//
+// Entries are content addressed: the key is a hash of the PDF bytes (plus size and extractor version),
+// so a renamed or re-uploaded file still hits and an edited file never does.
+// Layout: <directory>/<key>/meta holds the page count, <directory>/<key>/<page>.txt the text of one page.
+// Pages are stored one by one, so runs that extract only some pages (see ReportLoader::setRequiredSections) fill the entry over time.
+//
+// Every file is written to a unique temporary name and renamed into place, so several processes can share
+// one directory without locking: readers see either a whole page or none. Any I/O problem is treated as a miss,
+// the cache never fails an extraction.
+class ExtractionCache {
+    public:
+        static constexpr std::uintmax_t DEFAULT_MAX_BYTES = 256ull * 1024 * 1024;
+
+        explicit ExtractionCache(std::filesystem::path aDirectory, std::uintmax_t aMaxBytes = DEFAULT_MAX_BYTES);
+
+        // <user cache dir>/EdavkiXmlMaker/extraction, falls back to the temp directory
+        static std::filesystem::path defaultDirectory();
+
+        static uint64_t hashBytes(std::string_view aBytes);
+        // aVariant separates entries of different extraction flavours of the same PDF (e.g. "cells")
+        static std::string makeKey(std::string_view aPdfBytes, int aExtractorVersion, std::string_view aVariant = {});
+
+        // Reading the page count marks the entry as recently used
+        std::optional<int> loadPageCount(const std::string& aKey) const;
+        std::optional<std::string> loadPage(const std::string& aKey, int aPage) const;
+
+        void storePageCount(const std::string& aKey, int aPageCount) const;
+        void storePage(const std::string& aKey, int aPage, std::string_view aText) const;
+
+        // Evict least recently used entries until the cache fits into the size cap
+        void trim() const;
+
+        const std::filesystem::path& directory() const { return mDirectory; }
+
+    private:
+        std::filesystem::path mDirectory;
+        std::uintmax_t mMaxBytes;
+
+        bool writeAtomically(const std::filesystem::path& aPath, std::string_view aContent) const;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "line_index.hpp"
+
+// Forward and backward line navigation over report text, without copying lines.
+// Lines are handed out as views: the raw line (without its '\n') and the same line trimmed of whitespace.
+// The "1: " prefix some extractions put in front of the first line is dropped, as the parsers never want it.
+//
+// The text is either one buffer owned by someone else (raw text, mapped file) or pages pulled one by one
+// from a source while reading (Streaming mode). Pulled pages stay readable while they are among the last
+// aWindowPages pages up to the cursor, so stepping back over a page break keeps working.
+// Line views stay valid as long as their page is retained, i.e. for the whole parse over a buffer.
+// The buffer, or each page as it is pulled, is split into lines by a LineIndex, so moving is indexing.
+class LineCursor {
+    public:
+        struct Line {
+            std::string_view mRaw;
+            std::string_view mText; // Trimmed
+        };
+
+        using PageSource = std::function<std::optional<std::string>()>; // std::nullopt at the end of the text
+
+        explicit LineCursor(std::string_view aText);
+        LineCursor(PageSource aSource, size_t aWindowPages);
+
+        std::optional<Line> next();
+        std::optional<Line> peek(); // next() without moving
+        // Step back before the line returned by the last next(), false at the start of the retained text
+        bool unread();
+        // aCount-th line ahead of the cursor (1 = peek()) or behind it (1 = the line returned by the last next())
+        std::optional<Line> lookahead(size_t aCount);
+        std::optional<Line> lookbehind(size_t aCount) const;
+
+    private:
+        struct Position {
+            size_t mChunk {0}; // Absolute chunk index
+            size_t mLine {0};  // Line in the chunk
+        };
+
+        PageSource mSource {};
+        size_t mWindowPages {1};
+        std::deque<LineIndex> mChunks {};
+        std::deque<std::string> mOwnedPages {}; // Backing store of mChunks for pulled pages
+        size_t mFirstChunk {0};                 // Absolute index of mChunks.front()
+        Position mPosition {};
+
+        const LineIndex& chunk(size_t aChunk) const { return mChunks[aChunk - mFirstChunk]; }
+        bool pull();
+        void dropOldPages();
+        std::optional<Line> read(Position& aPosition);
+        bool retreat(Position& aPosition) const;
+        std::optional<Line> lineAt(Position aPosition) const;
+        static Line makeLine(const LineIndex& aLines, size_t aLine);
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "transaction_store.hpp"
+
+// Part of a sale taken from one purchase
+struct LotMatch {
+    std::uint32_t mBuyRow;     // Rows of GainTransactions
+    std::uint32_t mSellRow;
+    double mQuantity;          // Units of the purchase sold
+    std::int32_t mHoldingDays; // Days from the purchase to the sale
+    double mRealizedGain;      // mQuantity * (sale price - purchase price), negative for a loss
+};
+
+// Units a sale sold beyond the open lots of its security, e.g. bought before the report period
+struct UnmatchedSale {
+    std::uint32_t mSellRow;
+    double mQuantity;
+};
+
+// Sales matched against purchases first in, first out, the accounting method of the report.
+// Each security keeps its open lots in one contiguous queue: purchases are appended, sales take units from the
+// front, partially when a lot is larger than what is left to sell, so one pass over the sorted rows matches all.
+// Purchases without units open no lot.
+class LotMatcher {
+    public:
+        // Share of a lot or a sale left over from rounding fractional units, it counts as sold out.
+        // Relative, so large lots are not left open with a rounding error above any fixed unit count
+        static constexpr double QUANTITY_TOLERANCE = 1e-9;
+
+        // Sorts aTransactions and matches all of its sales
+        static LotMatcher fifo(GainTransactions& aTransactions);
+
+        // By security in ISIN order, then by sale and by purchase
+        std::span<const LotMatch> matches() const { return mMatches; }
+        std::span<const LotMatch> matches(GainTransactions::Security aSecurity) const;
+        std::span<const UnmatchedSale> unmatched() const { return mUnmatched; }
+
+        double realizedGain(GainTransactions::Security aSecurity) const;
+        double openQuantity(GainTransactions::Security aSecurity) const { return mOpenQuantities[aSecurity]; }
+
+    private:
+        std::vector<LotMatch> mMatches {};
+        std::vector<std::uint32_t> mOffsets {0};   // First match of every security and the match count
+        std::vector<UnmatchedSale> mUnmatched {};
+        std::vector<double> mOpenQuantities {};    // Units still held, by security
+};
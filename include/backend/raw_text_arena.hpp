@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Contiguous buffer with the extracted text of all pages plus an index of where each page lies.
+// Pages are appended in place (no temporary per page), every page is followed by '\n' like in the
+// flat text the parsers read. The buffer grows in large chunks, or exactly once when the total size
+// is known up front and passed to reserve().
+class RawTextArena {
+    public:
+        static constexpr size_t MIN_GROWTH_BYTES = 256 * 1024;
+
+        struct PageSpan {
+            int mPage;      // Page index in the document
+            size_t mOffset; // Start of the page text in view()
+            size_t mLength; // Length without the terminating '\n'
+        };
+
+        void reserve(size_t aBytes);
+        void appendPage(int aPage, std::string_view aText);
+        void assign(std::string_view aText); // Text of unknown page structure, indexed as one page
+        void clear();
+        void release(); // clear() and give the memory back
+
+        bool empty() const { return mBuffer.empty(); }
+        size_t size() const { return mBuffer.size(); }
+        std::string_view view() const { return mBuffer; }
+
+        const std::vector<PageSpan>& pages() const { return mPages; }
+        std::string_view page(size_t aIndex) const;
+
+    private:
+        std::string mBuffer {};
+        std::vector<PageSpan> mPages {};
+
+        void grow(size_t aAdditionalBytes);
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "report_lines.hpp"
+
+// Wording of the report the parsers recognise, shared read-only by any number of ReportLoader instances and threads.
+// The structure of the lines is compiled into report_lines.hpp. The words it is made of (section titles, line labels,
+// transaction types) come from a ReportGrammar: the built-in wording, or a grammar file replacing some of it, so a
+// report printed with new wording can be read without a rebuild. Everything is prepared once when the grammar is
+// built, matching a line costs the same as with the compiled-in wording.
+//
+// Grammar file (JSON), every key of report_lines::words::KEYS is optional:
+//   {"version": 1, "words": {"asset_type": ["Asset Type:", "Asset class:"], "trading_buy": ["Trading Buy", "Buy"]}}
+// A key lists what the report may print for the word, in match order, and replaces the built-in wording.
+// Labels end at their colon, the space or tab after them is part of the line grammar.
+// Matched transaction types are reported in the built-in wording whatever was printed.
+class ReportGrammar {
+    public:
+        static constexpr int FILE_VERSION = 1; // Bump on incompatible changes to the grammar file format
+
+        static std::shared_ptr<const ReportGrammar> standard();
+        // Read once per path and process, later calls share the grammar. Throws std::runtime_error on an invalid file
+        static std::shared_ptr<const ReportGrammar> load(const std::filesystem::path& aPath);
+
+        template <typename Grammar>
+        std::optional<typename Grammar::Result> match(std::string_view aLine) const {
+            return Grammar::match(aLine, &mWords);
+        }
+
+        template <typename Classifier>
+        typename Classifier::Result classify(std::string_view aLine) const {
+            return Classifier::classify(aLine, table<Classifier>(), &mWords);
+        }
+
+        bool is(report_lines::words::Id aWord, std::string_view aText) const;       // aText is one of the printed alternatives
+        bool contains(report_lines::words::Id aWord, std::string_view aText) const; // aText contains one of them
+        std::string_view canonical(std::string_view aWord) const;                  // Built-in wording of a printed word, else aWord
+
+    private:
+        explicit ReportGrammar(grammar::Vocabulary aWords);
+
+        template <typename Classifier>
+        const typename Classifier::Table& table() const {
+            using namespace report_lines;
+            if constexpr (std::is_same_v<Classifier, IncomeLines>) {
+                return mIncomeTable;
+            } else if constexpr (std::is_same_v<Classifier, GainsLines>) {
+                return mGainsTable;
+            } else if constexpr (std::is_same_v<Classifier, WithholdingLines>) {
+                return mWithholdingTable;
+            } else {
+                static_assert(std::is_same_v<Classifier, HistoryLines>, "classifier without a table");
+                return mHistoryTable;
+            }
+        }
+
+        grammar::Vocabulary mWords;
+        std::map<std::string, std::string_view, std::less<>> mCanonical; // Printed word -> built-in wording
+        report_lines::IncomeLines::Table mIncomeTable;
+        report_lines::GainsLines::Table mGainsTable;
+        report_lines::WithholdingLines::Table mWithholdingTable;
+        report_lines::HistoryLines::Table mHistoryTable;
+};
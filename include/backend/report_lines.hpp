@@ -0,0 +1,132 @@
+#pragma once
+
+#include "line_grammar.hpp"
+
+// Grammars of the report lines the parsers recognise, matched against trimmed lines.
+// The regex each one replaces is quoted above it.
+// The wording they are made of is listed in words, ReportGrammar can replace it without a rebuild.
+namespace report_lines {
+    using namespace grammar;
+
+    namespace words {
+        enum Id : size_t {
+            SECTION_INCOME,
+            SECTION_GAINS,
+            SECTION_WITHHOLDING,
+            SECTION_HISTORY,
+            TABLE_OF_CONTENT,
+            ASSET_TYPE,
+            COUNTRY,
+            REPORT_ID,
+            INTEREST_PAYMENT,
+            DIVIDEND,
+            INCOME_TOTAL,
+            TRADING_BUY,
+            TRADING_SELL,
+            GAINS,
+            LOSSES,
+            WITHHOLDING_TOTAL,
+            OVERALL_TOTAL,
+            COUNT
+        };
+
+        // Key of each word in a grammar file
+        inline constexpr std::array<std::string_view, COUNT> KEYS {
+            "section_income", "section_gains", "section_withholding", "section_history", "table_of_content",
+            "asset_type", "country", "report_id", "interest_payment", "dividend", "income_total",
+            "trading_buy", "trading_sell", "gains", "losses", "withholding_total", "overall_total",
+        };
+
+        // Wording of the reports so far, values read from the report are given in it whatever was printed
+        inline constexpr std::array<std::string_view, COUNT> DEFAULTS {
+            "Detailed Income Section", "Detailed Gains and Losses Section", "Detailed Withholding Tax Section",
+            "History of Transactions and Corporate Actions", "Table of Content",
+            "Asset Type:", "Country:", "Report ID:", "Interest payment", "Dividend", "Total for ",
+            "Trading Buy", "Trading Sell", "Gains", "Losses", "Total for", "Overall Total In EUR",
+        };
+    }
+
+    template <words::Id Id>
+    using Say = Word<Id, words::DEFAULTS>;
+
+    using Spaces    = Run<SpaceChars>;    // \s+
+    using OptSpaces = OptRun<SpaceChars>; // \s*
+    using Rest      = Run<AnyChars>;      // .+ up to the end of the line
+    using LabelGap  = Any<Lit<" ">, Lit<"\t">>; // [ \t] after a "Label:"
+
+    // \d{2}\.\d{2}\.\d{4}
+    using Date = Seq<Repeat<2, DigitChars>, Lit<".">, Repeat<2, DigitChars>, Lit<".">, Repeat<4, DigitChars>>;
+    // -?\d{1,3}(?:,\d{3})*(?:\.\d+)?
+    using GroupedNumber = Seq<Opt<Lit<"-">>, Between<1, 3, DigitChars>, Star<Seq<Lit<",">, Repeat<3, DigitChars>>>,
+                              Opt<Seq<Lit<".">, Run<DigitChars>>>>;
+    using Number       = Run<NumberChars>;              // [\d,.]+
+    using SignedNumber = Seq<Opt<Lit<"-">>, Number>;    // -?[\d,.]+
+    using Decimal      = Run<DecimalChars>;             // [\d.]+
+    using TradeType    = Any<Say<words::TRADING_BUY>, Say<words::TRADING_SELL>>;
+
+    // ^([IVX]+\.)\s+(.+)$
+    using SectionLine = Line<2, Group<1, Seq<Run<RomanChars>, Lit<".">>>, Spaces, Group<2, Rest>>;
+    // ^[IVX]+\s+(.+?)\s+(\d+)$, a table of contents row
+    using TocEntryLine = Line<2, Run<RomanChars>, Spaces, Group<1, LazyRun<AnyChars>>, Spaces, Group<2, Run<DigitChars>>>;
+    // ^(Client|Period|Currency|Country):\s+(.+)$
+    using HeaderLine = Line<2, Group<1, OneOf<"Client", "Period", "Currency", "Country">>, Lit<":">, Spaces, Group<2, Rest>>;
+    // ^Asset Type:[ \t](.+)$, a space in flat text or the cell separator in Cells layout.
+    // Further spaces stay in the value, the income parser tells page headers by them
+    using AssetTypeLine = Line<1, Say<words::ASSET_TYPE>, LabelGap, Group<1, Rest>>;
+    // ^Country:[ \t](.+)$
+    using CountryLine = Line<1, Say<words::COUNTRY>, LabelGap, Group<1, Rest>>;
+    // ^([A-Z0-9]+)\s+-\s+(.+)$
+    using IsinLine = Line<2, Group<1, Run<UpperAlnumChars>>, Spaces, Lit<"-">, Spaces, Group<2, Rest>>;
+
+    // ^(Interest payment|Dividend)\s+(\d{2}\.\d{2}\.\d{4})\s+([\d,.]+)\s+([\d,.]+)\s*$
+    using IncomePaymentLine = Line<4, Group<1, Any<Say<words::INTEREST_PAYMENT>, Say<words::DIVIDEND>>>, Spaces, Group<2, Date>, Spaces,
+                                   Group<3, Number>, Spaces, Group<4, Number>, OptSpaces>;
+    // ^EUR\s+([\d,.]+)\s+(-?[\d,.]+)?\s*([\d,.]+)?\s*$
+    using IncomeAmountLine = Line<3, Lit<"EUR">, Spaces, Group<1, Number>, Spaces, Opt<Group<2, SignedNumber>>, OptSpaces,
+                                  Opt<Group<3, Number>>, OptSpaces>;
+    // ^Total for ([A-Za-z\s]+).*$
+    using IncomeTotalLine = Line<1, Say<words::INCOME_TOTAL>, Group<1, Run<AlphaSpaceChars>>, OptRun<AnyChars>>;
+
+    // ^(Trading Buy|Trading Sell)\s+(date)\s+(grouped number)\s+(grouped number)\s*$
+    using GainsTransactionLine = Line<4, Group<1, TradeType>, Spaces, Group<2, Date>, Spaces, Group<3, GroupedNumber>, Spaces,
+                                      Group<4, GroupedNumber>, OptSpaces>;
+    // ^EUR\s+(grouped number) x6$
+    using GainsAmountLine = Line<6, Lit<"EUR">, Spaces, Group<1, GroupedNumber>, Spaces, Group<2, GroupedNumber>, Spaces,
+                                 Group<3, GroupedNumber>, Spaces, Group<4, GroupedNumber>, Spaces, Group<5, GroupedNumber>, Spaces,
+                                 Group<6, GroupedNumber>>;
+    // ^(Gains|Losses)\s+EUR\s+(grouped number) x3$
+    using GainsTotalLine = Line<4, Group<1, Any<Say<words::GAINS>, Say<words::LOSSES>>>, Spaces, Lit<"EUR">, Spaces,
+                                Group<2, GroupedNumber>, Spaces, Group<3, GroupedNumber>, Spaces, Group<4, GroupedNumber>>;
+    // ^Report ID:\s+(.+)$
+    using ReportIdLine = Line<1, Say<words::REPORT_ID>, Spaces, Group<1, Rest>>;
+
+    // ^([A-Za-z\s]+)$
+    using WithholdingCountryLine = Line<1, Group<1, Run<AlphaSpaceChars>>>;
+    // ^(Dividend)\s+(\d{2}\.\d{2}\.\d{4})\s+([\d\.]+)\s*$
+    using WithholdingDividendLine = Line<3, Group<1, Say<words::DIVIDEND>>, Spaces, Group<2, Date>, Spaces, Group<3, Decimal>, OptSpaces>;
+    // ^EUR\s+([\d\.]+)\s+([\d\.]+)\s+([\d\.]+%)\s+([\d\.]+)\s*$
+    using WithholdingAmountLine = Line<4, Lit<"EUR">, Spaces, Group<1, Decimal>, Spaces, Group<2, Decimal>, Spaces,
+                                       Group<3, Seq<Decimal, Lit<"%">>>, Spaces, Group<4, Decimal>, OptSpaces>;
+    // ^(Total for|Overall Total In EUR)\s+([\d\.]+)\s+([\d\.]+)$
+    using WithholdingTotalLine = Line<3, Group<1, Any<Say<words::WITHHOLDING_TOTAL>, Say<words::OVERALL_TOTAL>>>, Spaces, Group<2, Decimal>, Spaces,
+                                      Group<3, Decimal>>;
+
+    // ^(Trading Buy|Trading Sell)\s+(date)\s+(date)\s+EUR\s+([\d\.,]+)\s+(-?[\d\.,]+)\s+([\d\.,]+)\s+([\d\.,]+)$
+    using HistoryTransactionLine = Line<7, Group<1, TradeType>, Spaces, Group<2, Date>, Spaces, Group<3, Date>, Spaces, Lit<"EUR">,
+                                        Spaces, Group<4, Number>, Spaces, Group<5, SignedNumber>, Spaces, Group<6, Number>, Spaces,
+                                        Group<7, Number>>;
+
+    // Lines each section parser tells apart, in the order the checks used to run
+    using IncomeLines = Classifier<SectionLine, IncomeTotalLine, AssetTypeLine, CountryLine, IsinLine, IncomePaymentLine>;
+    using GainsLines = Classifier<SectionLine, AssetTypeLine, CountryLine, IsinLine, GainsTotalLine, GainsTransactionLine, ReportIdLine>;
+    using WithholdingLines = Classifier<SectionLine, WithholdingCountryLine, IsinLine, WithholdingDividendLine, WithholdingTotalLine>;
+    using HistoryLines = Classifier<SectionLine, IsinLine, HistoryTransactionLine>;
+
+    static_assert(SectionLine::matches("V. Detailed Income Section"));
+    static_assert(GainsTransactionLine::matches("Trading Buy   01.02.2024   1,234.5   1.0000"));
+    static_assert(!GainsTransactionLine::matches("Trading Buy   01.02.2024   1234.5   1.0000"));
+    static_assert(IncomeAmountLine::match("EUR 0.14 -0.02")->matched(2) && !IncomeAmountLine::match("EUR 0.14 -0.02")->matched(3));
+    static_assert(GainsLines::classify("Trading Sell 01.02.2024 1 1").is<GainsTransactionLine>());
+    static_assert(WithholdingLines::classify("Total for Germany").is<WithholdingCountryLine>());
+    static_assert(IncomeLines::classify("Asset Type: Funds").is<AssetTypeLine>());
+}
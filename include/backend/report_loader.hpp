@@ -5,25 +5,92 @@
 #include <vector>
 #include <optional>
 #include <sstream>
+#include <istream>
+#include <fstream>
+#include <memory>
+#include <functional>
+#include <map>
+#include <set>
 #include <string_view>
+#include <span>
 
+#include "raw_text_arena.hpp"
+#include "temp_file.hpp"
+
+namespace poppler {
+    class document;
+}
+
+class ExtractionCache;
+class MappedFile;
+class LineCursor;
+class ReportGrammar;
+struct Transactions;
+enum class TransactionType;
+
+// Loaders share nothing mutable: every parse keeps its state on the stack, the grammar and extraction cache are
+// read-only or synchronised, and temporary files are created exclusively. Any number of loaders can run concurrently
+// in one process, one loader is used by one thread at a time.
 class ReportLoader {
     public:
         enum class ProcessingMode {
             InMemory,  // Store the raw text in memory (suitable for small PDFs)
-            FileBased  // Write the raw text to a temporary file (suitable for large PDFs)
+            FileBased, // Write the raw text to a temporary file and parse it through a memory mapping (suitable for large PDFs)
+            Parallel,  // Extract page ranges on worker threads and merge them in memory (suitable for large PDFs on multi-core machines)
+            Streaming, // Extract pages into a bounded queue while convertToJson parses them (keeps only a few pages in memory)
+            Auto       // InMemory or FileBased, chosen from the page count, input size and memory budget
+        };
+
+        // How page text is obtained from poppler
+        enum class TextLayout {
+            Flat, // page::text(), table columns are padded with spaces
+            Cells // Lines rebuilt from positioned words (page::text_list), table cells separated by '\t'
+        };
+
+        static constexpr size_t DEFAULT_MEMORY_BUDGET_BYTES = 64 * 1024 * 1024;
+        static constexpr int EXTRACTOR_VERSION = 2; // Bump when page text extraction changes, it invalidates ExtractionCache entries
+
+        // Detailed sections of the report, used to extract and parse only what a tax form needs
+        enum class ReportSection {
+            Income,
+            GainsAndLosses,
+            WithholdingTax,
+            TransactionHistory
         };
 
-        ReportLoader() = default;
+        ReportLoader();
 
         void getRawPdfData(const std::string& aPdfPath, ProcessingMode aMode = ProcessingMode::InMemory);
+        // PDF bytes already in memory (upload buffer, mapping). Streaming mode reads them until convertToJson returns,
+        // the buffer must stay valid until then
+        void getRawPdfData(std::span<const std::byte> aPdfData, ProcessingMode aMode = ProcessingMode::InMemory);
         nlohmann::json convertToJson();
+        // Same parse as convertToJson, straight into the records the tax forms are built from.
+        // Gains of other asset types than aTypes are left out, like XmlGenerator::parse_json does
+        Transactions convertToTransactions(const std::set<TransactionType>& aTypes);
         void clearRawText();
+        void setThreadCount(unsigned aThreadCount);
+        void setRequiredSections(std::set<ReportSection> aSections); // Empty set -> whole report
+        void setExtractionCache(std::shared_ptr<const ExtractionCache> aCache); // nullptr -> no caching
+        void setMemoryBudget(size_t aBytes); // Per job limit for Auto mode
+        void setTextLayout(TextLayout aLayout);
+        void setGrammar(std::shared_ptr<const ReportGrammar> aGrammar); // nullptr -> ReportGrammar::standard()
+        void setStripBoilerplate(bool aStrip); // Drop page headers/footers repeated on every page, on by default
+        void setParallelSections(bool aParallel); // Parse the detailed sections and their pages concurrently in convertToJson, off by default
+        size_t strippedBytes() const;          // Bytes of boilerplate dropped by the last getRawPdfData/convertToJson
+        ProcessingMode processingMode() const; // Mode actually used, Auto resolves to InMemory or FileBased
         
         #ifdef UNIT_TEST
         bool saveRawDataToFile(const std::string& aOutputPath) const;
-        void setRawText(const std::string& aText);
-        const std::string& getRawText() const;
+        void setRawText(const std::string& aText, ProcessingMode aMode = ProcessingMode::InMemory); // FileBased writes a temporary file
+        // Like extracted PDF pages, boilerplate is stripped. Auto chooses and spills as if aResidentInput bytes of a caller's buffer were loaded
+        void setRawPages(const std::vector<std::string>& aPages, ProcessingMode aMode = ProcessingMode::InMemory, size_t aResidentInput = 0);
+        const std::vector<int>& selectedPages() const; // Pages chosen for the required sections, 0 based
+        void consumeStream(const std::function<void(LineCursor&)>& aConsume); // Streaming pipeline with aConsume in place of the parser
+        bool hasRawText() const;
+        const std::filesystem::path& tempFilePath() const; // Empty unless the text is FileBased
+        std::string_view getRawText() const;
+        const RawTextArena& getRawTextArena() const;
         #endif
 
     private:
@@ -35,22 +102,143 @@ class ReportLoader {
             nlohmann::json mTotals;
         };
 
+        // Detailed section rows stay typed until the caller asks for JSON or Transactions
+        struct IncomeRow {
+            bool mDeposit {false};          // Liquidity interest, has no ISIN and no withholding tax
+            std::string mIsin {};
+            std::string mType {};
+            std::string mValueDate {};
+            double mAmount {0.0};
+            double mExchangeRate {0.0};
+            double mGrossIncome {0.0};
+            double mWithholdingTax {0.0};
+            double mNetIncome {0.0};
+        };
+
+        struct IncomeSection {
+            std::string mAssetType {};
+            std::string mCountry {};
+            std::vector<IncomeRow> mTransactions {};
+        };
+
+        // Row of the gains or history section
+        struct TradeRow {
+            std::string mIsin {};
+            std::string mType {};
+            std::string mDate {};
+            std::string mValueDate {};           // History only
+            double mAmount {0.0};
+            double mExchangeRate {0.0};
+            std::optional<double> mUnitPrice {}; // Gains only, from the EUR line below the row
+            double mMarketValue {0.0};           // History only
+        };
+
+        struct GainsSection {
+            std::string mAssetType {};
+            std::string mCountry {};
+            std::vector<TradeRow> mTransactions {};
+        };
+
+        struct HistoryGroup {
+            std::string mIsin {};
+            std::vector<TradeRow> mTransactions {};
+        };
+
+        // One page of the gains or history section, its lines parsed but not yet put in context.
+        // Rows ahead of the page's first ISIN line continue the block left open on the page before,
+        // so pages can be parsed in any order and are joined in page order afterwards.
+        struct SectionPage {
+            enum class EntryKind {
+                AssetType,
+                Country,
+                Isin,
+                Total,
+                Row,
+                PageEnd // Page break or "Report ID" footer, the open block carries over to the next page
+            };
+
+            struct Entry {
+                EntryKind mKind;
+                std::string mValue {}; // Asset type, country or ISIN
+                TradeRow mRow {};      // Without its ISIN
+            };
+
+            std::vector<Entry> mEntries {};
+        };
+
+        // Output of one parse over report text. A section starts over on every page under a repeated heading,
+        // the last income ISIN carries over to payments on the next page that are not under an ISIN line.
+        struct ParseState {
+            nlohmann::json mHeader {};
+            std::vector<IncomeSection> mIncome {};
+            std::vector<SectionPage> mGainsPages {};
+            std::vector<nlohmann::json> mWithholding {};
+            std::vector<SectionPage> mHistoryPages {};
+            std::string mLastIncomeIsin {};
+        };
+
+        struct PageSelection {
+            std::vector<int> mPages {};                // Page indices to extract, in document order
+            std::map<int, std::string> mPrefetched {}; // Pages already extracted while reading the table of contents
+            std::map<std::string, int> mBoilerplate {}; // Line fingerprint -> the only page that keeps the line
+        };
+
+        // Opens the document on first use, so pages served from prefetch or cache never touch poppler
+        using DocumentAccess = std::function<const poppler::document&()>;
+
         ProcessingMode mMode = ProcessingMode::InMemory;
-        std::string mRawText {};
-        std::string mTempFilePath {};
-        std::string mClientNumber {};
-        TransactionContext mLastContext {};
+        unsigned mThreadCount {0}; // 0 -> use std::thread::hardware_concurrency()
+        size_t mMemoryBudget {DEFAULT_MEMORY_BUDGET_BYTES};
+        TextLayout mTextLayout {TextLayout::Flat};
+        bool mStripBoilerplate {true};
+        bool mParallelSections {false};
+        size_t mStrippedBytes {0};
+        std::set<ReportSection> mRequiredSections {};
+        std::shared_ptr<const ReportGrammar> mGrammar {}; // Wording of the report, shared with other loaders
+        PageSelection mSelection {};
+        std::shared_ptr<const ExtractionCache> mCache {};
+        std::string mCacheKey {};
+        std::string mPdfName {};                         // Path of the input, used in error messages
+        std::span<const std::byte> mPdfData {};          // Input bytes, valid while the document may be opened
+        std::shared_ptr<const MappedFile> mMappedPdf {}; // Owns mPdfData when the input was given by path
+        RawTextArena mRawText {};
+        TempFile mTempFile {};                           // FileBased text, deleted with the loader
+        std::shared_ptr<poppler::document> mDocument {}; // Kept open until convertToJson/convertToTransactions in Streaming mode
         
-        void parseHeader(std::istringstream& aIss, nlohmann::json& aResult);
-        void parseIncomeSection(std::istringstream& aIss, std::vector<nlohmann::json>& aIncomeSections);
-        void parseGainsAndLossesSection(std::istringstream& aIss, std::vector<nlohmann::json>& aGainsSections);
-        void parseWithholdingTaxSection(std::istringstream& aIss, std::vector<nlohmann::json>& aWithholdingSections);
-        void parseTransactionHistorySection(std::istringstream& aIss, std::vector<nlohmann::json>& aTransactionHistory);
+        void loadPdf(std::span<const std::byte> aPdfData, const std::string& aPdfName, ProcessingMode aMode,
+                     std::shared_ptr<const MappedFile> aMapping);
+        ProcessingMode autoMode(size_t aResidentInput) const;
+        bool extractInMemory(const DocumentAccess& aDocument, bool aSpillOverBudget, size_t aResidentInput); // False without any text
+        bool extractToFile(const DocumentAccess& aDocument);
+        std::ofstream createTempFile();
+        const poppler::document& document();
+        std::unique_ptr<poppler::document> openDocument() const;
+        void selectPages(int aNumPages, const DocumentAccess& aDocument);
+        void detectBoilerplate(const DocumentAccess& aDocument);
+        size_t stripBoilerplate(int aPage, std::string& aText) const;
+        std::string selectedPageText(const DocumentAccess& aDocument, int aPage, size_t& aStrippedBytes);
+        std::string loadPageText(const DocumentAccess& aDocument, int aPage) const;
+        std::vector<std::string> extractPagesParallel(const DocumentAccess& aDocument);
+
+        ParseState parseLoaded();
+        ParseState parseStream();
+        void streamSelection(const std::function<void(LineCursor&)>& aConsume); // Pages are extracted while aConsume reads them
+        ParseState parseReport(LineCursor& aCursor) const;
+        ParseState parseReportBySection(std::string_view aText) const;
+        void parseSections(LineCursor& aCursor, ParseState& aState) const;
+        nlohmann::json toJson(ParseState& aState) const;
+        Transactions toTransactions(ParseState& aState, const std::set<TransactionType>& aTypes) const;
+
+        void parseHeader(LineCursor& aCursor, nlohmann::json& aResult) const;
+        void parseIncomeSection(LineCursor& aCursor, std::vector<IncomeSection>& aIncomeSections, std::string& aLastIsin) const;
+        void parseGainsAndLossesSection(LineCursor& aCursor, std::vector<SectionPage>& aPages) const;
+        void parseWithholdingTaxSection(LineCursor& aCursor, std::vector<nlohmann::json>& aWithholdingSections) const;
+        void parseTransactionHistorySection(LineCursor& aCursor, std::vector<SectionPage>& aPages) const;
+        std::vector<GainsSection> joinGainsPages(std::vector<SectionPage>& aPages) const;
+        std::vector<HistoryGroup> joinHistoryPages(std::vector<SectionPage>& aPages) const;
         
-        std::string trim(std::string_view aLine) const;
-        std::optional<std::string> extractLine(std::istringstream& aIss) const;
-        std::optional<double> parseDouble(const std::string& aValue) const;
+        std::optional<double> parseDouble(std::string_view aValue) const;
         std::vector<std::string> tokenize(std::string_view aLine) const;
-        std::vector<std::string> normalizeSpaces(const std::string &aLine) const;
+        std::vector<std::string> normalizeSpaces(std::string_view aLine) const;
 };
 
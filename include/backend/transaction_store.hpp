@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Strings kept once and referred to by a dense id, e.g. the ISINs of thousands of savings plan trades
+class StringPool {
+    public:
+        using Id = std::uint32_t;
+
+        Id intern(std::string_view aText);
+        std::optional<Id> find(std::string_view aText) const;
+        std::string_view operator[](Id aId) const { return mStrings[aId]; }
+        size_t size() const { return mStrings.size(); }
+        std::vector<Id> sort(); // Renumbers the strings in lexicographic order, returns the new id of every old id
+
+    private:
+        std::map<std::string, Id, std::less<>> mIds {};
+        std::vector<std::string> mStrings {};
+};
+
+enum class TradeType : std::uint8_t {
+    Buy,
+    Sell
+};
+
+// Rows of transactions stored column by column, every row belonging to a security (ISIN) and a day.
+// Dates are day numbers (days since 1970-01-01), so ordering and date differences are integer operations.
+// sort() groups the rows by ISIN in ISIN order and by date within a security, keeping the order rows were
+// added in for the same day, and indexes where the rows of every security start.
+class SecurityRows {
+    public:
+        using Security = StringPool::Id;
+
+        size_t size() const { return mDays.size(); }
+        bool empty() const { return mDays.empty(); }
+        bool sorted() const { return mSorted; }
+
+        size_t securityCount() const { return mIsins.size(); }
+        std::optional<Security> find(std::string_view aIsin) const { return mIsins.find(aIsin); }
+        std::string_view isin(Security aSecurity) const { return mIsins[aSecurity]; }
+        std::string_view name(Security aSecurity) const { return mNames[aSecurity]; }
+
+        // Indices of the rows of a security, by date. Securities are numbered in ISIN order once sorted
+        auto rows(Security aSecurity) const {
+            requireSorted();
+            return std::views::iota(size_t {mOffsets[aSecurity]}, size_t {mOffsets[aSecurity + 1]});
+        }
+
+        std::span<const Security> securities() const { return mSecurities; }
+        std::span<const std::int32_t> days() const { return mDays; }
+
+    protected:
+        size_t addRow(std::string_view aIsin, std::string_view aName, std::int32_t aDay);
+        std::vector<std::uint32_t> sortRows(); // Returns the old index of every row, for the columns of the derived store
+
+        template <typename T>
+        static void permute(std::vector<T>& aColumn, const std::vector<std::uint32_t>& aOrder) {
+            std::vector<T> sorted;
+            sorted.reserve(aColumn.size());
+            for (const auto row : aOrder) {
+                sorted.push_back(std::move(aColumn[row]));
+            }
+            aColumn = std::move(sorted);
+        }
+
+    private:
+        StringPool mIsins {};
+        std::vector<std::string> mNames {};       // Security name, by security
+        std::vector<Security> mSecurities {};     // By row
+        std::vector<std::int32_t> mDays {};       // By row
+        std::vector<std::uint32_t> mOffsets {0};  // First row of every security and the row count, valid once sorted
+        bool mSorted {true};
+
+        void requireSorted() const;
+};
+
+// Trades of the gains section that have a unit price, the input of Doh-KDVP
+class GainTransactions : public SecurityRows {
+    public:
+        void add(std::string_view aIsin, std::string_view aName, std::int32_t aDay, TradeType aType, double aQuantity, double aUnitPrice);
+        void sort();
+
+        std::span<const TradeType> types() const { return mTypes; }
+        std::span<const double> quantities() const { return mQuantities; }
+        std::span<const double> unitPrices() const { return mUnitPrices; }
+
+    private:
+        std::vector<TradeType> mTypes {};
+        std::vector<double> mQuantities {};
+        std::vector<double> mUnitPrices {};
+};
+
+// Dividends of the income section, the input of Doh-Div
+class DividendTransactions : public SecurityRows {
+    public:
+        void add(std::string_view aIsin, std::string_view aName, std::int32_t aDay, std::string_view aCountry, double aGrossIncome,
+                 double aWithholdingTax);
+        void sort();
+
+        std::string_view country(size_t aRow) const { return mCountryNames[mCountries[aRow]]; }
+        std::span<const double> grossIncomes() const { return mGrossIncomes; }
+        std::span<const double> withholdingTaxes() const { return mWithholdingTaxes; }
+
+    private:
+        StringPool mCountryNames {};
+        std::vector<StringPool::Id> mCountries {};
+        std::vector<double> mGrossIncomes {};
+        std::vector<double> mWithholdingTaxes {};
+};
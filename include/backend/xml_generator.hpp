@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <optional>
@@ -7,6 +8,9 @@
 #include <pugixml.hpp>
 #include <set>
 
+#include "transaction_store.hpp"
+#include "lot_matcher.hpp"
+
 
 enum class InventoryListType {
     PLVP,
@@ -46,7 +50,7 @@ enum class DhoPayer {
 };
 
 struct RowPurchase {
-    std::optional<std::string> mF1;  // date of acquisition
+    std::optional<std::int32_t> mF1; // date of acquisition (day number)
     std::optional<GainType>    mF2;  // method of acquisition
     std::optional<double>      mF3;  // quantity
     std::optional<double>      mF4;  // purchase value per unit
@@ -55,10 +59,10 @@ struct RowPurchase {
 };
 
 struct RowSale {
-    std::optional<std::string> mF6;  // date of disposal
+    std::optional<std::int32_t> mF6; // date of disposal (day number)
     std::optional<double>      mF7;  // quantity / % / payment
     std::optional<double>      mF9;  // value at disposal
-    std::optional<bool>        mF10; // rule 97.č ZDoh-2 (full versions only) -> losses substract gains if not bought until 30 days from loss sell pass
+    std::optional<bool>        mF10; // rule 97.č ZDoh-2 (full versions only) -> losses substract gains if not bought within 30 days before or after the loss sell
 };
 
 struct InventoryRow {
@@ -111,7 +115,7 @@ struct DivPayer {
 };
 
 struct DivItem {
-    std::string                mDate;
+    std::int32_t               mDate{0};   // day number
     DivPayer                   mPayer;
     std::string                mType{"1"}; // 1 -regular dividend, 2 - non physical person, 3 - loan gains distribution (look on furs instructions at "vrsta dividende")
     double                     mGrossIncome;
@@ -179,24 +183,6 @@ struct FormHeaderData {
     TaxPayer      mTaxPayer;
 };
 
-struct GainTransaction {
-    std::string mDate;
-    std::string mType;  // "Trading Buy" or "Trading Sell"
-    std::string mIsin;
-    std::string mIsinName;
-    double      mQuantity{0.0};
-    double      mUnitPrice{0.0};
-};
-
-struct DivTransaction {
-    std::string mDate;
-    std::string mIsin;
-    std::string mIsinName;
-    std::string mCountryName;
-    double      mGrossIncome{0.0};
-    double      mWitholdTax{0.0};
-};
-
 struct DhoTransaction {
     std::string mPayer;
     double      mGrossIncome{0.0};
@@ -204,12 +190,12 @@ struct DhoTransaction {
 };
 
 struct IncomeTransactions {
-    std::map<std::string, std::vector<DivTransaction>> mDivTransactions;
+    DividendTransactions mDivTransactions;
     std::map<std::string, std::vector<DhoTransaction>>  mInterests;
 };
 
 struct Transactions {
-    std::map<std::string, std::vector<GainTransaction>> mGains;
+    GainTransactions mGains;
     IncomeTransactions mIncome;
 };
 
@@ -220,11 +206,13 @@ public:
     
     // XML generation
     // KDVP
-    static DohKDVP_Data prepare_kdvp_data(std::map<std::string, std::vector<GainTransaction>>& aTransactions, FormData& aFormData);
+    // Securities are prepared on aThreadCount threads (0 -> std::thread::hardware_concurrency()), the result does not depend on it.
+    // Throws std::invalid_argument if a sale sells more units than were bought before it
+    static DohKDVP_Data prepare_kdvp_data(GainTransactions& aTransactions, FormData& aFormData, unsigned aThreadCount = 0);
     pugi::xml_document generate_doh_kdvp_xml(const DohKDVP_Data& data, const TaxPayer& tp);
     
     // Div
-    static DohDiv_Data prepare_div_data(std::map<std::string, std::vector<DivTransaction>>& aTransactions, FormData& aFormData);
+    static DohDiv_Data prepare_div_data(DividendTransactions& aTransactions, FormData& aFormData);
     pugi::xml_document generate_doh_div_xml(const DohDiv_Data& data, const TaxPayer& tp);
     
     // Dho
@@ -236,6 +224,10 @@ private:
     void append_edp_header(pugi::xml_node envelope, FormHeaderData headerData);
     static void append_edp_taxpayer(pugi::xml_node header, const TaxPayer& tp);
     
+    // aMatches are the FIFO matches of the security's sales
+    static KDVPItem prepare_kdvp_item(const GainTransactions& aTransactions, GainTransactions::Security aSecurity,
+                                      std::span<const LotMatch> aMatches);
+
     static pugi::xml_node generate_doh_kdvp(pugi::xml_node parent, const DohKDVP_Data& data);
     static pugi::xml_node generate_doh_div(pugi::xml_node parent, const DohDiv_Data& data);
     static pugi::xml_node generate_doh_dho(pugi::xml_node parent, const DohDho_Data& data);
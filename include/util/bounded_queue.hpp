@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// Blocking producer/consumer queue with a fixed capacity.
+// push() waits while the queue is full, pop() waits while it is empty.
+// After close() pushes are rejected and pop() drains the remaining items, then returns std::nullopt.
+template <typename T>
+class BoundedQueue {
+    public:
+        explicit BoundedQueue(size_t aCapacity) : mCapacity {aCapacity == 0 ? 1 : aCapacity} {}
+
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        // Returns false if the queue was closed (consumer is gone), the item is dropped
+        bool push(T aItem) {
+            std::unique_lock lock {mMutex};
+            mNotFull.wait(lock, [this] { return mClosed || mItems.size() < mCapacity; });
+            if (mClosed) {
+                return false;
+            }
+            mItems.push_back(std::move(aItem));
+            mNotEmpty.notify_one();
+            return true;
+        }
+
+        std::optional<T> pop() {
+            std::unique_lock lock {mMutex};
+            mNotEmpty.wait(lock, [this] { return mClosed || !mItems.empty(); });
+            if (mItems.empty()) {
+                return std::nullopt;
+            }
+            T item {std::move(mItems.front())};
+            mItems.pop_front();
+            mNotFull.notify_one();
+            return item;
+        }
+
+        void close() {
+            {
+                std::lock_guard lock {mMutex};
+                mClosed = true;
+            }
+            mNotFull.notify_all();
+            mNotEmpty.notify_all();
+        }
+
+    private:
+        const size_t mCapacity;
+        bool mClosed {false};
+        std::deque<T> mItems {};
+        std::mutex mMutex {};
+        std::condition_variable mNotFull {};
+        std::condition_variable mNotEmpty {};
+};
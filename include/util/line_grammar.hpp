@@ -0,0 +1,415 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Line grammars built from templates, so every pattern is turned into straight-line matching code at compile time.
+// Nothing is constructed or interpreted at run time and patterns can be checked with static_assert.
+//
+// A grammar mirrors an anchored ECMAScript regex (std::regex_match) for the subset the report parsers use:
+//   Lit<"EUR">                 EUR
+//   OneOf<"Gains", "Losses">   (?:Gains|Losses)
+//   Run<DigitChars>            \d+     possessive, it never gives characters back
+//   OptRun<SpaceChars>         \s*     possessive
+//   LazyRun<AnyChars>          .+?
+//   Between<1, 3, DigitChars>  \d{1,3}
+//   Opt<E>, Star<E>            (?:E)?, (?:E)*  greedy, with backtracking
+//   Seq<E...>                  (?:E...)
+//   Group<1, E>                (E)     capture number as in the regex
+//   Word<Id, Defaults>         (?:word|...)  literals given at run time, see below
+//   Any<E...>                  (?:E|E|...)
+// Possessive runs are only used where the following element cannot start with a character of the run,
+// there they match exactly what the backtracking regex would.
+//
+// Every element also knows whether it can match the empty string (NULLABLE) and which characters it can start with
+// (startsWith), Classifier uses them to build a first character dispatch table at compile time.
+//
+// Word elements stand for wording that can change without a rebuild: they match the alternatives a Vocabulary lists
+// under their id, handed in with the match, or Defaults[Id] when matching without one (and in constant expressions).
+// A vocabulary changes which characters a grammar can start with, Classifier::table builds the dispatch table for it.
+namespace grammar {
+    using Vocabulary = std::vector<std::vector<std::string>>; // Alternatives by word id, in match order, none empty
+
+    template <size_t N>
+    struct Literal {
+        char mText[N] {};
+
+        constexpr Literal(const char (&aText)[N]) { std::copy_n(aText, N, mText); }
+        constexpr std::string_view view() const { return {mText, N - 1}; }
+    };
+
+    // Character classes, \s and \d as in the "C" locale
+    struct DigitChars {
+        static constexpr bool contains(char c) { return c >= '0' && c <= '9'; }
+    };
+    struct SpaceChars {
+        static constexpr bool contains(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+    };
+    struct AnyChars { // '.'
+        static constexpr bool contains(char c) { return c != '\n' && c != '\r'; }
+    };
+    struct RomanChars { // [IVX]
+        static constexpr bool contains(char c) { return c == 'I' || c == 'V' || c == 'X'; }
+    };
+    struct UpperAlnumChars { // [A-Z0-9]
+        static constexpr bool contains(char c) { return (c >= 'A' && c <= 'Z') || DigitChars::contains(c); }
+    };
+    struct AlphaSpaceChars { // [A-Za-z\s]
+        static constexpr bool contains(char c) { return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || SpaceChars::contains(c); }
+    };
+    struct NumberChars { // [\d,.]
+        static constexpr bool contains(char c) { return DigitChars::contains(c) || c == ',' || c == '.'; }
+    };
+    struct DecimalChars { // [\d.]
+        static constexpr bool contains(char c) { return DigitChars::contains(c) || c == '.'; }
+    };
+
+    // Capture groups of a successful match, index 0 is the whole line like std::smatch
+    template <size_t Groups>
+    struct Match {
+        std::array<std::string_view, Groups + 1> mGroups {};
+        std::array<size_t, Groups + 1> mStarts {};
+        const Vocabulary* mVocabulary {nullptr};
+
+        constexpr std::string_view operator[](size_t aIndex) const { return mGroups[aIndex]; }
+        constexpr bool matched(size_t aIndex) const { return mGroups[aIndex].data() != nullptr; }
+        std::string str(size_t aIndex) const { return std::string {mGroups[aIndex]}; }
+    };
+
+    // Elements match at aPos and hand the new position to the continuation Next, which matches the rest of the line.
+    // Alternatives are tried in regex order and the first complete match wins.
+    template <typename Chars>
+    constexpr size_t runLength(std::string_view aText, size_t aPos, size_t aMax = std::string_view::npos) {
+        size_t length {0};
+        while (aPos + length < aText.size() && length < aMax && Chars::contains(aText[aPos + length])) {
+            ++length;
+        }
+        return length;
+    }
+
+    struct End {
+        template <typename Captures>
+        static constexpr bool match(std::string_view aText, size_t aPos, Captures&) { return aPos == aText.size(); }
+    };
+
+    template <typename Element, typename Next>
+    struct Then {
+        template <typename Captures>
+        static constexpr bool match(std::string_view aText, size_t aPos, Captures& aCaptures) {
+            return Element::template match<Next>(aText, aPos, aCaptures);
+        }
+    };
+
+    template <Literal Text>
+    struct Lit {
+        static constexpr bool NULLABLE = Text.view().empty();
+        static constexpr bool startsWith(char c, const Vocabulary* = nullptr) { return !NULLABLE && Text.view().front() == c; }
+
+        template <typename Next, typename Captures>
+        static constexpr bool match(std::string_view aText, size_t aPos, Captures& aCaptures) {
+            return aText.substr(aPos).starts_with(Text.view()) && Next::match(aText, aPos + Text.view().size(), aCaptures);
+        }
+    };
+
+    template <Literal... Alternatives>
+    struct OneOf {
+        static constexpr bool NULLABLE = (Lit<Alternatives>::NULLABLE || ...);
+        static constexpr bool startsWith(char c, const Vocabulary* = nullptr) { return (Lit<Alternatives>::startsWith(c) || ...); }
+
+        template <typename Next, typename Captures>
+        static constexpr bool match(std::string_view aText, size_t aPos, Captures& aCaptures) {
+            return (Lit<Alternatives>::template match<Next>(aText, aPos, aCaptures) || ...);
+        }
+    };
+
+    template <size_t Id, const auto& Defaults>
+    struct Word {
+        static constexpr std::string_view DEFAULT = Defaults[Id];
+        static_assert(!DEFAULT.empty(), "words never match the empty string");
+
+        static constexpr bool NULLABLE = false;
+        static constexpr bool startsWith(char c, const Vocabulary* aVocabulary = nullptr) {
+            if (aVocabulary == nullptr) {
+                return DEFAULT.front() == c;
+            }
+            return std::any_of((*aVocabulary)[Id].begin(), (*aVocabulary)[Id].end(), [c](const std::string& aWord) { return aWord.front() == c; });
+        }
+
+        template <typename Next, typename Captures>
+        static constexpr bool match(std::string_view aText, size_t aPos, Captures& aCaptures) {
+            const auto rest = aText.substr(aPos);
+            if (aCaptures.mVocabulary == nullptr) {
+                return rest.starts_with(DEFAULT) && Next::match(aText, aPos + DEFAULT.size(), aCaptures);
+            }
+            for (const auto& word : (*aCaptures.mVocabulary)[Id]) {
+                if (rest.starts_with(word) && Next::match(aText, aPos + word.size(), aCaptures)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    template <typename... Alternatives>
+    struct Any {
+        static constexpr bool NULLABLE = (Alternatives::NULLABLE || ...);
+        static constexpr bool startsWith(char c, const Vocabulary* aVocabulary = nullptr) {
+            return (Alternatives::startsWith(c, aVocabulary) || ...);
+        }
+
+        template <typename Next, typename Captures>
+        static constexpr bool match(std::string_view aText, size_t aPos, Captures& aCaptures) {
+            return (Alternatives::template match<Next>(aText, aPos, aCaptures) || ...);
+        }
+    };
+
+    template <typename Chars>
+    struct Run {
+        static constexpr bool NULLABLE = false;
+        static constexpr bool startsWith(char c, const Vocabulary* = nullptr) { return Chars::contains(c); }
+
+        template <typename Next, typename Captures>
+        static constexpr bool match(std::string_view aText, size_t aPos, Captures& aCaptures) {
+            const auto length = runLength<Chars>(aText, aPos);
+            return length > 0 && Next::match(aText, aPos + length, aCaptures);
+        }
+    };
+
+    template <typename Chars>
+    struct OptRun {
+        static constexpr bool NULLABLE = true;
+        static constexpr bool startsWith(char c, const Vocabulary* = nullptr) { return Chars::contains(c); }
+
+        template <typename Next, typename Captures>
+        static constexpr bool match(std::string_view aText, size_t aPos, Captures& aCaptures) {
+            return Next::match(aText, aPos + runLength<Chars>(aText, aPos), aCaptures);
+        }
+    };
+
+    template <typename Chars>
+    struct LazyRun {
+        static constexpr bool NULLABLE = false;
+        static constexpr bool startsWith(char c, const Vocabulary* = nullptr) { return Chars::contains(c); }
+
+        template <typename Next, typename Captures>
+        static constexpr bool match(std::string_view aText, size_t aPos, Captures& aCaptures) {
+            const auto length = runLength<Chars>(aText, aPos);
+            for (size_t taken = 1; taken <= length; ++taken) {
+                if (Next::match(aText, aPos + taken, aCaptures)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    template <size_t Min, size_t Max, typename Chars>
+    struct Between {
+        static constexpr bool NULLABLE = Min == 0;
+        static constexpr bool startsWith(char c, const Vocabulary* = nullptr) { return Max > 0 && Chars::contains(c); }
+
+        template <typename Next, typename Captures>
+        static constexpr bool match(std::string_view aText, size_t aPos, Captures& aCaptures) {
+            const auto length = runLength<Chars>(aText, aPos, Max);
+            for (size_t taken = length + 1; taken-- > Min;) {
+                if (Next::match(aText, aPos + taken, aCaptures)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    template <size_t Count, typename Chars>
+    using Repeat = Between<Count, Count, Chars>;
+
+    template <typename... Elements>
+    struct Seq;
+
+    template <>
+    struct Seq<> {
+        static constexpr bool NULLABLE = true;
+        static constexpr bool startsWith(char, const Vocabulary* = nullptr) { return false; }
+
+        template <typename Next, typename Captures>
+        static constexpr bool match(std::string_view aText, size_t aPos, Captures& aCaptures) {
+            return Next::match(aText, aPos, aCaptures);
+        }
+    };
+
+    template <typename Element, typename... Rest>
+    struct Seq<Element, Rest...> {
+        static constexpr bool NULLABLE = Element::NULLABLE && Seq<Rest...>::NULLABLE;
+        static constexpr bool startsWith(char c, const Vocabulary* aVocabulary = nullptr) {
+            return Element::startsWith(c, aVocabulary) || (Element::NULLABLE && Seq<Rest...>::startsWith(c, aVocabulary));
+        }
+
+        template <typename Next, typename Captures>
+        static constexpr bool match(std::string_view aText, size_t aPos, Captures& aCaptures) {
+            return Element::template match<Then<Seq<Rest...>, Next>>(aText, aPos, aCaptures);
+        }
+    };
+
+    template <typename Element>
+    struct Opt {
+        static constexpr bool NULLABLE = true;
+        static constexpr bool startsWith(char c, const Vocabulary* aVocabulary = nullptr) { return Element::startsWith(c, aVocabulary); }
+
+        template <typename Next, typename Captures>
+        static constexpr bool match(std::string_view aText, size_t aPos, Captures& aCaptures) {
+            return Element::template match<Next>(aText, aPos, aCaptures) || Next::match(aText, aPos, aCaptures);
+        }
+    };
+
+    // Element must consume at least one character per repetition
+    template <typename Element>
+    struct Star {
+        static constexpr bool NULLABLE = true;
+        static constexpr bool startsWith(char c, const Vocabulary* aVocabulary = nullptr) { return Element::startsWith(c, aVocabulary); }
+
+        template <typename Next, typename Captures>
+        static constexpr bool match(std::string_view aText, size_t aPos, Captures& aCaptures) {
+            return Element::template match<Then<Star, Next>>(aText, aPos, aCaptures) || Next::match(aText, aPos, aCaptures);
+        }
+    };
+
+    template <size_t Index, typename Next>
+    struct CloseGroup {
+        template <typename Captures>
+        static constexpr bool match(std::string_view aText, size_t aPos, Captures& aCaptures) {
+            const auto previous = aCaptures.mGroups[Index];
+            aCaptures.mGroups[Index] = aText.substr(aCaptures.mStarts[Index], aPos - aCaptures.mStarts[Index]);
+            if (Next::match(aText, aPos, aCaptures)) {
+                return true;
+            }
+            aCaptures.mGroups[Index] = previous; // Failed branch, an optional group stays unmatched
+            return false;
+        }
+    };
+
+    template <size_t Index, typename Element>
+    struct Group {
+        static constexpr bool NULLABLE = Element::NULLABLE;
+        static constexpr bool startsWith(char c, const Vocabulary* aVocabulary = nullptr) { return Element::startsWith(c, aVocabulary); }
+
+        template <typename Next, typename Captures>
+        static constexpr bool match(std::string_view aText, size_t aPos, Captures& aCaptures) {
+            const auto previous = aCaptures.mStarts[Index];
+            aCaptures.mStarts[Index] = aPos;
+            if (Element::template match<CloseGroup<Index, Next>>(aText, aPos, aCaptures)) {
+                return true;
+            }
+            aCaptures.mStarts[Index] = previous;
+            return false;
+        }
+    };
+
+    // Whole line grammar, anchored at both ends like std::regex_match
+    template <size_t Groups, typename... Elements>
+    struct Line {
+        using Result = Match<Groups>;
+
+        static constexpr size_t GROUPS = Groups;
+        static constexpr bool NULLABLE = Seq<Elements...>::NULLABLE;
+        static constexpr bool startsWith(char c, const Vocabulary* aVocabulary = nullptr) { return Seq<Elements...>::startsWith(c, aVocabulary); }
+
+        static constexpr std::optional<Result> match(std::string_view aLine, const Vocabulary* aVocabulary = nullptr) {
+            Result result {};
+            result.mVocabulary = aVocabulary;
+            if (!matchInto(aLine, result)) {
+                return std::nullopt;
+            }
+            return result;
+        }
+
+        static constexpr bool matches(std::string_view aLine, const Vocabulary* aVocabulary = nullptr) {
+            return match(aLine, aVocabulary).has_value();
+        }
+
+        // Captures may have more groups than the grammar, unused ones stay unmatched. Words come from aCaptures.mVocabulary
+        template <typename Captures>
+        static constexpr bool matchInto(std::string_view aLine, Captures& aCaptures) {
+            if (!Seq<Elements...>::template match<End>(aLine, 0, aCaptures)) {
+                return false;
+            }
+            aCaptures.mGroups[0] = aLine;
+            return true;
+        }
+    };
+
+    // Sorts a line into the first of several Line grammars that matches, in a single dispatch.
+    // A table built at compile time maps the first character of the line to the grammars that can start with it,
+    // only those are run. Grammars are listed in priority order, like a chain of regex_match calls,
+    // so a line matching several of them gets the kind of the first.
+    template <typename... Grammars>
+    class Classifier {
+        static_assert(sizeof...(Grammars) <= 32, "one candidate bit per grammar");
+
+        public:
+            using Table = std::array<uint32_t, 256>; // Candidate grammars by first character
+
+            static constexpr size_t NONE = sizeof...(Grammars);
+            static constexpr size_t MAX_GROUPS = std::max({Grammars::GROUPS...});
+
+            // Kind of a grammar, usable as a case label
+            template <typename Grammar>
+            static constexpr size_t KIND = [] {
+                size_t index {0};
+                ((std::is_same_v<Grammar, Grammars> ? false : (++index, true)) && ...);
+                return index;
+            }();
+
+            struct Result : Match<MAX_GROUPS> {
+                size_t mKind {NONE};
+
+                template <typename Grammar>
+                constexpr bool is() const { return mKind == KIND<Grammar>; }
+            };
+
+            static constexpr Result classify(std::string_view aLine) {
+                return classify(aLine, FIRST_CHAR_CANDIDATES, nullptr);
+            }
+
+            // With the words of aVocabulary, aTable must be table(aVocabulary)
+            static constexpr Result classify(std::string_view aLine, const Table& aTable, const Vocabulary* aVocabulary) {
+                Result result {};
+                result.mVocabulary = aVocabulary;
+                const auto candidates = aLine.empty() ? EMPTY_CANDIDATES : aTable[static_cast<unsigned char>(aLine.front())];
+                tryCandidates(aLine, candidates, result, std::index_sequence_for<Grammars...> {});
+                return result;
+            }
+
+            static constexpr Table table(const Vocabulary* aVocabulary = nullptr) {
+                Table candidates {};
+                for (size_t c = 0; c < candidates.size(); ++c) {
+                    const auto ch = static_cast<char>(c);
+                    uint32_t bit {1};
+                    ((candidates[c] |= Grammars::startsWith(ch, aVocabulary) || Grammars::NULLABLE ? bit : 0, bit <<= 1), ...);
+                }
+                return candidates;
+            }
+
+        private:
+            static constexpr uint32_t EMPTY_CANDIDATES = [] {
+                uint32_t bits {0};
+                uint32_t bit {1};
+                ((bits |= Grammars::NULLABLE ? bit : 0, bit <<= 1), ...);
+                return bits;
+            }();
+
+            static constexpr Table FIRST_CHAR_CANDIDATES = table();
+
+            template <size_t... Kinds>
+            static constexpr void tryCandidates(std::string_view aLine, uint32_t aCandidates, Result& aResult, std::index_sequence<Kinds...>) {
+                ((((aCandidates >> Kinds) & 1u) && Grammars::matchInto(aLine, aResult) && (aResult.mKind = Kinds, true)) || ...);
+            }
+    };
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Line table of a text: where every line starts and ends and where it starts and ends once trimmed of whitespace.
+// Built in one pass that tests 16 (SSE2) or 32 (AVX2) bytes at a time for line breaks and whitespace, the widest
+// instruction set the CPU supports is picked at runtime. Other CPUs find each '\n' and trim every line on its own.
+// Lines are split on '\n' like std::getline does: no line follows a final '\n', and '\r' is whitespace of its line.
+class LineIndex {
+    public:
+        enum class Isa {
+            Scalar,
+            Sse2,
+            Avx2,
+        };
+
+        // Offsets into the text, [mBegin, mEnd) without the '\n', [mTextBegin, mTextEnd) trimmed (empty for blank lines)
+        struct Bounds {
+            std::uint32_t mBegin;
+            std::uint32_t mEnd;
+            std::uint32_t mTextBegin;
+            std::uint32_t mTextEnd;
+        };
+
+        LineIndex() = default;
+        explicit LineIndex(std::string_view aText);
+        LineIndex(std::string_view aText, Isa aIsa); // Forces a code path, for tests and benchmarks
+
+        size_t size() const { return mLines.size(); }
+        const Bounds& operator[](size_t aLine) const { return mLines[aLine]; }
+        std::string_view raw(size_t aLine) const;
+        std::string_view text(size_t aLine) const;
+
+        static Isa bestIsa();
+        static bool supported(Isa aIsa);
+
+    private:
+        std::string_view mText {};
+        std::vector<Bounds> mLines {};
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+// Read-only memory mapping of a whole file.
+// The contents are paged in by the OS on access and can be dropped again under memory pressure,
+// so large files are read without holding a private copy in memory.
+// Throws std::runtime_error if the file cannot be opened or mapped.
+class MappedFile {
+    public:
+        explicit MappedFile(const std::filesystem::path& aPath);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& aOther) noexcept;
+        MappedFile& operator=(MappedFile&& aOther) noexcept;
+
+        std::string_view view() const { return {mData, mSize}; }
+        size_t size() const { return mSize; }
+
+    private:
+        const char* mData {nullptr};
+        size_t mSize {0};
+        #ifdef _WIN32
+        void* mMapping {nullptr}; // HANDLE of the file mapping object
+        #endif
+
+        void unmap() noexcept;
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// Numbers as the reports print them: an optional sign, ',' as thousands separator and '.' as decimal point.
+// Separators and whitespace anywhere in the text are skipped, "-1,234.5" and "1 234.5" are both numbers.
+// Nothing throws and nothing is allocated, the status tells why a text is not a number and the
+// result is only written on ParseStatus::Ok.
+namespace numbers {
+    enum class ParseStatus {
+        Ok,
+        Empty,      // Nothing but separators and whitespace
+        Invalid,    // Not a number, or characters after it
+        OutOfRange, // Does not fit the result, or more than 64 characters with separators
+    };
+
+    ParseStatus parseDouble(std::string_view aText, double& aValue);
+
+    // Fixed point amount in hundredths, further decimals are rounded half away from zero.
+    // Plain decimal notation only, no exponent.
+    ParseStatus parseCents(std::string_view aText, std::int64_t& aCents);
+}
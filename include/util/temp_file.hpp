@@ -0,0 +1,26 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+// Empty file created under a name no other loader, thread or process is given at the same time,
+// deleted again when the owner replaces it or goes away.
+// Throws std::runtime_error if the file cannot be created.
+class TempFile {
+    public:
+        TempFile() = default;
+        TempFile(const std::filesystem::path& aDirectory, const std::string& aPrefix);
+        ~TempFile();
+
+        TempFile(const TempFile&) = delete;
+        TempFile& operator=(const TempFile&) = delete;
+        TempFile(TempFile&& aOther) noexcept;
+        TempFile& operator=(TempFile&& aOther) noexcept;
+
+        const std::filesystem::path& path() const { return mPath; }
+        bool empty() const { return mPath.empty(); }
+        void remove() noexcept; // Deletes the file now, leaves the object empty
+
+    private:
+        std::filesystem::path mPath {};
+};
@@ -4,26 +4,41 @@
 #include <sstream>
 #include <iomanip>   
 #include <set>
+#include <array>
 #include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string_view>
 
 #include "xml_generator.hpp"
 
-// Helper function to parse date from DD.MM.YYYY to YYYY-MM-DD
-std::string parse_date(const std::string& date_str);
+// YYYY-MM-DD text of a day number, held in place so formatting a date never allocates
+struct DayText {
+    std::array<char, 11> mText{};   // Null terminated
 
-// Helper to calculate days between two dates in YYYY-MM-DD format
-int days_between(const std::string& from, const std::string& to);
+    const char* c_str() const { return mText.data(); }
+    std::string_view view() const { return {mText.data(), mText.size() - 1}; }
+    bool operator==(std::string_view other) const { return view() == other; }
+};
+
+// Helper to parse date from DD.MM.YYYY to a day number (days since 1970-01-01), dates are kept as day numbers
+// until XML is written, so sorting and date differences are integer operations
+std::int32_t parse_day(std::string_view date_str);
+
+// Helper to format a day number as YYYY-MM-DD
+DayText format_day(std::int32_t day);
 
 // Helper to extract ISIN code and name from "ISIN - Name" format
 void parse_isin(const std::string& isin_str, std::string& code, std::string& name);
 
 TransactionType string_to_asset_type(std::string mType);
+std::optional<TradeType> string_to_trade_type(std::string_view mType);
 std::string form_type_to_string(FormType t);
 std::string form_type_to_string_code(FormType t);
 std::string to_xml_decimal(double value, int precision);
 
 // Parse gains and losses section
-void parse_gains_section(const nlohmann::json& gains_section, std::set<TransactionType> aTypes, std::map<std::string, std::vector<GainTransaction>>& aTransactions);
+void parse_gains_section(const nlohmann::json& gains_section, std::set<TransactionType> aTypes, GainTransactions& aTransactions);
 
 // Parse income (dividend) section
 void parse_income_section(const nlohmann::json& div_section, IncomeTransactions& aTransactions);
\ No newline at end of file
@@ -1,19 +1,30 @@
 #include "application_service.hpp"
 #include "report_loader.hpp"
+#include "report_grammar.hpp"
 #include "xml_generator.hpp"
 #include <fstream>
 
+namespace {
+    // Report sections each tax form is generated from, everything else can be skipped
+    std::set<ReportLoader::ReportSection> requiredSections(TaxFormType aFormType) {
+        switch (aFormType) {
+            case TaxFormType::Doh_KDVP: return {ReportLoader::ReportSection::GainsAndLosses};
+            case TaxFormType::Doh_DIV:  return {ReportLoader::ReportSection::Income};
+            case TaxFormType::Doh_DHO:  return {ReportLoader::ReportSection::Income};
+        }
+        return {};
+    }
+}
+
 // THE FIX: Define the incomplete type here
 struct ApplicationService::Impl {
     void generateXml(const GenerationRequest& request, 
-                     const nlohmann::json& jsonData, 
+                     Transactions& transactions, 
                      const TaxPayer& taxpayer,
                      const FormData& formData,
                      std::vector<std::filesystem::path>& outFiles) 
     {
         XmlGenerator generator;
-        Transactions transactions;
-        XmlGenerator::parse_json(transactions, {TransactionType::Equities, TransactionType::Funds}, jsonData);
         
         if (request.formType == TaxFormType::Doh_KDVP) {
             auto data = XmlGenerator::prepare_kdvp_data(transactions.mGains, (FormData&)formData);
@@ -55,7 +66,7 @@ GenerationResult ApplicationService::processRequest(const GenerationRequest& req
 GenerationResult ApplicationService::processRequest(const GenerationRequest& request, ReportLoader& loader) {
     GenerationResult result;
     try {
-        if (!std::filesystem::exists(request.inputFile)) {
+        if (!request.inputData && !std::filesystem::exists(request.inputFile)) {
             throw std::runtime_error("File does not exist: " + request.inputFile.string());
         }
         if (!std::filesystem::exists(request.outputDirectory)) {
@@ -74,33 +85,66 @@ GenerationResult ApplicationService::processRequest(const GenerationRequest& req
             throw std::runtime_error("Unsupported file format: " + ext + ". Please provide a .pdf or .json file.");
         }
 
-        nlohmann::json jsonData;
+        const std::set<TransactionType> assetTypes {TransactionType::Equities, TransactionType::Funds};
+        Transactions transactions;
 
         if (ext == ".json") {
-            std::ifstream ifs(request.inputFile);
-            jsonData = nlohmann::json::parse(ifs);
+            nlohmann::json jsonData;
+            if (request.inputData) {
+                const auto* data = reinterpret_cast<const char*>(request.inputData->data());
+                jsonData = nlohmann::json::parse(data, data + request.inputData->size());
+            } else {
+                std::ifstream ifs(request.inputFile);
+                jsonData = nlohmann::json::parse(ifs);
+            }
 
             if (!jsonData.contains("income_section") || !jsonData.contains("gains_and_losses_section")) {
                 throw std::runtime_error("Invalid JSON structure: Missing Trade Republic report sections.");
             }
+            XmlGenerator::parse_json(transactions, assetTypes, jsonData);
         } else {
+            // The extracted text, and the temporary file it may have spilled to, go away however the request ends
+            struct ReleaseText {
+                ReportLoader& mLoader;
+                ~ReleaseText() { mLoader.clearRawText(); }
+            } releaseText {loader};
+
+            // Intermediate JSON is a debugging aid, so it always holds the whole report
+            loader.setRequiredSections(request.jsonOnly ? std::set<ReportLoader::ReportSection>{} : requiredSections(request.formType));
+            loader.setMemoryBudget(request.memoryBudgetBytes);
+            if (request.cacheDirectory) {
+                loader.setExtractionCache(std::make_shared<ExtractionCache>(*request.cacheDirectory, request.cacheMaxBytes));
+            }
+            if (request.grammarFile) {
+                loader.setGrammar(ReportGrammar::load(*request.grammarFile));
+            }
+
+            auto loadPdf = [&]() {
+                if (request.inputData) {
+                    loader.getRawPdfData(*request.inputData, ReportLoader::ProcessingMode::Auto);
+                } else {
+                    loader.getRawPdfData(request.inputFile.string(), ReportLoader::ProcessingMode::Auto);
+                }
+            };
+
 #ifdef UNIT_TEST
-            if (loader.getRawText().empty()) {
-                loader.getRawPdfData(request.inputFile.string(), ReportLoader::ProcessingMode::InMemory);
+            if (!loader.hasRawText()) {
+                loadPdf();
             }
 #else
-            loader.getRawPdfData(request.inputFile.string(), ReportLoader::ProcessingMode::InMemory);
+            loadPdf();
 #endif
-            jsonData = loader.convertToJson();
-
             if (request.jsonOnly) {
                 auto jsonPath = request.outputDirectory / "intermediate_data.json";
                 std::ofstream out(jsonPath);
-                out << jsonData.dump(4);
+                out << loader.convertToJson().dump(4);
                 result.createdFiles.push_back(jsonPath);
                 result.success = true;
                 return result;
             }
+
+            // The forms are built straight from the parsed report, the intermediate JSON is skipped
+            transactions = loader.convertToTransactions(assetTypes);
         }
 
         // Map request to domain objects
@@ -120,7 +164,7 @@ GenerationResult ApplicationService::processRequest(const GenerationRequest& req
         if (request.phone) formData.mTelephoneNumber = *request.phone;
         if (request.email) formData.mEmail           = *request.email;
 
-        m_pImpl->generateXml(request, jsonData, taxpayer, formData, result.createdFiles);
+        m_pImpl->generateXml(request, transactions, taxpayer, formData, result.createdFiles);
 
         result.success = true;
     } catch (const std::exception& e) {
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cmath>
+
+#include "cell_layout.hpp"
+
+namespace {
+    bool isDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+}
+
+namespace cell_layout {
+    std::string layoutPage(std::vector<Word> aWords) {
+        if (aWords.empty()) {
+            return "\f";
+        }
+
+        std::stable_sort(aWords.begin(), aWords.end(), [](const Word& a, const Word& b) {
+            return a.mCenterY != b.mCenterY ? a.mCenterY < b.mCenterY : a.mLeft < b.mLeft;
+        });
+
+        // Group into lines, a word belongs to the line if its center lies within half a line height
+        std::vector<std::vector<Word>> lines;
+        std::vector<double> lineCenters;
+        for (auto& word : aWords) {
+            if (lines.empty() || word.mCenterY - lineCenters.back() > std::max(word.mHeight, lines.back().front().mHeight) / 2) {
+                lines.emplace_back();
+                lineCenters.push_back(word.mCenterY);
+            }
+            lines.back().push_back(std::move(word));
+        }
+
+        // The median distance between lines is the line pitch, larger distances stand for empty lines
+        std::vector<double> distances;
+        for (size_t i = 1; i < lineCenters.size(); ++i) {
+            distances.push_back(lineCenters[i] - lineCenters[i - 1]);
+        }
+        double pitch {0.0};
+        if (!distances.empty()) {
+            auto middle = distances.begin() + static_cast<std::ptrdiff_t>(distances.size() / 2);
+            std::nth_element(distances.begin(), middle, distances.end());
+            pitch = *middle;
+        }
+
+        std::string text;
+        for (size_t i = 0; i < lines.size(); ++i) {
+            if (i > 0 && pitch > 0.0) {
+                const auto emptyLines = std::lround((lineCenters[i] - lineCenters[i - 1]) / pitch) - 1;
+                text.append(static_cast<size_t>(std::clamp<long>(emptyLines, 0, 100)), '\n');
+            }
+
+            auto& line = lines[i];
+            std::sort(line.begin(), line.end(), [](const Word& a, const Word& b) { return a.mLeft < b.mLeft; });
+            for (size_t w = 0; w < line.size(); ++w) {
+                if (w > 0) {
+                    const auto gap = line[w].mLeft - line[w - 1].mRight;
+                    text += gap >= GAP_CHARS * line[w - 1].mCharWidth ? SEPARATOR : ' ';
+                }
+                text += line[w].mText;
+            }
+            text += '\n';
+        }
+        text += '\f'; // Page break, like page::text()
+        return text;
+    }
+
+    std::vector<std::string_view> splitCells(std::string_view aLine) {
+        std::vector<std::string_view> cells;
+        if (aLine.find(SEPARATOR) == std::string_view::npos) {
+            return cells;
+        }
+        size_t start {0};
+        while (start <= aLine.size()) {
+            const auto end = std::min(aLine.find(SEPARATOR, start), aLine.size());
+            cells.push_back(aLine.substr(start, end - start));
+            start = end + 1;
+        }
+        return cells;
+    }
+
+    bool isDate(std::string_view aCell) {
+        if (aCell.size() != 10) {
+            return false;
+        }
+        for (size_t i = 0; i < aCell.size(); ++i) {
+            if (i == 2 || i == 5 ? aCell[i] != '.' : !isDigit(aCell[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool isGroupedNumber(std::string_view aCell) {
+        if (aCell.starts_with('-')) {
+            aCell.remove_prefix(1);
+        }
+        const auto point = aCell.find('.');
+        auto integer = aCell.substr(0, point);
+        if (point != std::string_view::npos) {
+            const auto fraction = aCell.substr(point + 1);
+            if (fraction.empty() || !std::all_of(fraction.begin(), fraction.end(), isDigit)) {
+                return false;
+            }
+        }
+
+        const auto firstGroup = integer.find(',');
+        const auto head = integer.substr(0, firstGroup);
+        if (head.empty() || head.size() > 3 || !std::all_of(head.begin(), head.end(), isDigit)) {
+            return false;
+        }
+        if (firstGroup == std::string_view::npos) {
+            return true;
+        }
+        integer.remove_prefix(firstGroup);
+        if (integer.size() % 4 != 0) {
+            return false;
+        }
+        for (size_t i = 0; i < integer.size(); i += 4) {
+            if (integer[i] != ',' || !std::all_of(integer.begin() + i + 1, integer.begin() + i + 4, isDigit)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool isLooseNumber(std::string_view aCell, bool aSigned) {
+        if (aSigned && aCell.starts_with('-')) {
+            aCell.remove_prefix(1);
+        }
+        return !aCell.empty() && std::all_of(aCell.begin(), aCell.end(), [](char c) { return isDigit(c) || c == '.' || c == ','; });
+    }
+}
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "extraction_cache.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr auto META_FILE_NAME = "meta";
+    constexpr auto PAGE_FILE_EXTENSION = ".txt";
+
+    constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t PRIME_3 = 0x165667B19E3779F9ull;
+    constexpr uint64_t PRIME_4 = 0x85EBCA77C2B2AE63ull;
+    constexpr uint64_t PRIME_5 = 0x27D4EB2F165667C5ull;
+
+    fs::path pageFileName(int aPage) {
+        return std::to_string(aPage) + PAGE_FILE_EXTENSION;
+    }
+
+    std::optional<std::string> readFile(const fs::path& aPath) {
+        std::ifstream file {aPath, std::ios::binary};
+        if (!file) {
+            return std::nullopt;
+        }
+        std::ostringstream buffer;
+        buffer << file.rdbuf();
+        if (file.bad()) {
+            return std::nullopt;
+        }
+        return buffer.str();
+    }
+
+    // Unique per process and thread, so concurrent writers never share a temporary file
+    std::string temporarySuffix() {
+        static const auto processToken = std::random_device {}();
+        static std::atomic<uint64_t> counter {0};
+        std::ostringstream suffix;
+        suffix << ".tmp." << std::hex << processToken << '.' << std::hash<std::thread::id> {}(std::this_thread::get_id()) << '.' << counter++;
+        return suffix.str();
+    }
+}
+
+ExtractionCache::ExtractionCache(fs::path aDirectory, std::uintmax_t aMaxBytes)
+    : mDirectory {std::move(aDirectory)}, mMaxBytes {aMaxBytes} {}
+
+fs::path ExtractionCache::defaultDirectory() {
+    fs::path base;
+#ifdef _WIN32
+    if (const char* localAppData = std::getenv("LOCALAPPDATA")) base = localAppData;
+#elif defined(__APPLE__)
+    if (const char* home = std::getenv("HOME")) base = fs::path {home} / "Library" / "Caches";
+#else
+    if (const char* xdgCache = std::getenv("XDG_CACHE_HOME")) base = xdgCache;
+    else if (const char* home = std::getenv("HOME")) base = fs::path {home} / ".cache";
+#endif
+    if (base.empty()) {
+        base = fs::temp_directory_path();
+    }
+    return base / "EdavkiXmlMaker" / "extraction";
+}
+
+// 64-bit multiply-rotate hash over 8 byte words, a few GB/s and well distributed for content addressing
+uint64_t ExtractionCache::hashBytes(std::string_view aBytes) {
+    uint64_t hash = PRIME_5 + static_cast<uint64_t>(aBytes.size());
+    size_t i {0};
+
+    for (; i + 8 <= aBytes.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, aBytes.data() + i, sizeof(word));
+        word = std::rotl(word * PRIME_2, 31) * PRIME_1;
+        hash = std::rotl(hash ^ word, 27) * PRIME_1 + PRIME_4;
+    }
+    for (; i < aBytes.size(); ++i) {
+        hash ^= static_cast<uint64_t>(static_cast<unsigned char>(aBytes[i])) * PRIME_5;
+        hash = std::rotl(hash, 11) * PRIME_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME_2;
+    hash ^= hash >> 29;
+    hash *= PRIME_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+std::string ExtractionCache::makeKey(std::string_view aPdfBytes, int aExtractorVersion, std::string_view aVariant) {
+    std::ostringstream key;
+    key << std::hex << hashBytes(aPdfBytes) << std::dec << '-' << aPdfBytes.size() << "-v" << aExtractorVersion;
+    if (!aVariant.empty()) {
+        key << '-' << aVariant;
+    }
+    return key.str();
+}
+
+std::optional<int> ExtractionCache::loadPageCount(const std::string& aKey) const {
+    const auto metaPath = mDirectory / aKey / META_FILE_NAME;
+    const auto content = readFile(metaPath);
+    if (!content) {
+        return std::nullopt;
+    }
+
+    int pageCount {0};
+    std::istringstream iss {*content};
+    if (!(iss >> pageCount) || pageCount <= 0) {
+        return std::nullopt;
+    }
+
+    // LRU bookkeeping: the meta file time stamp is the last use of the entry
+    std::error_code ec;
+    fs::last_write_time(metaPath, fs::file_time_type::clock::now(), ec);
+    return pageCount;
+}
+
+std::optional<std::string> ExtractionCache::loadPage(const std::string& aKey, int aPage) const {
+    return readFile(mDirectory / aKey / pageFileName(aPage));
+}
+
+void ExtractionCache::storePageCount(const std::string& aKey, int aPageCount) const {
+    writeAtomically(mDirectory / aKey / META_FILE_NAME, std::to_string(aPageCount) + "\n");
+}
+
+void ExtractionCache::storePage(const std::string& aKey, int aPage, std::string_view aText) const {
+    writeAtomically(mDirectory / aKey / pageFileName(aPage), aText);
+}
+
+bool ExtractionCache::writeAtomically(const fs::path& aPath, std::string_view aContent) const {
+    std::error_code ec;
+    fs::create_directories(aPath.parent_path(), ec);
+
+    fs::path tempPath {aPath};
+    tempPath += temporarySuffix();
+    {
+        std::ofstream file {tempPath, std::ios::binary};
+        if (!file || !file.write(aContent.data(), static_cast<std::streamsize>(aContent.size()))) {
+            file.close();
+            fs::remove(tempPath, ec);
+            return false;
+        }
+    }
+
+    // rename replaces the target atomically, a concurrent reader sees the old or the new file but never a partial one
+    fs::rename(tempPath, aPath, ec);
+    if (ec) {
+        fs::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+void ExtractionCache::trim() const {
+    struct Entry {
+        fs::path mPath;
+        fs::file_time_type mLastUse;
+        std::uintmax_t mSize;
+    };
+
+    std::error_code ec;
+    std::vector<Entry> entries;
+    std::uintmax_t totalSize {0};
+
+    for (const auto& dir : fs::directory_iterator {mDirectory, ec}) {
+        if (!dir.is_directory(ec)) {
+            continue;
+        }
+
+        Entry entry {dir.path(), fs::file_time_type::min(), 0};
+        for (const auto& file : fs::directory_iterator {dir.path(), ec}) {
+            const auto size = file.file_size(ec);
+            entry.mSize += ec ? 0 : size;
+        }
+        // Entries without meta file are being written right now or are broken, they are evicted first
+        const auto lastUse = fs::last_write_time(dir.path() / META_FILE_NAME, ec);
+        if (!ec) {
+            entry.mLastUse = lastUse;
+        }
+
+        totalSize += entry.mSize;
+        entries.push_back(std::move(entry));
+    }
+
+    if (totalSize <= mMaxBytes) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.mLastUse < b.mLastUse; });
+
+    for (const auto& entry : entries) {
+        if (totalSize <= mMaxBytes) {
+            break;
+        }
+        // Another process may be reading or evicting the same entry, failures are ignored
+        fs::remove_all(entry.mPath, ec);
+        totalSize -= entry.mSize;
+    }
+}
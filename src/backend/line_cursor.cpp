@@ -0,0 +1,134 @@
+#include <algorithm>
+
+#include "line_cursor.hpp"
+
+namespace {
+    constexpr std::string_view WHITESPACE = " \t\n\v\f\r";
+    constexpr std::string_view EXTRACTION_LINE_PREFIX = "1: ";
+}
+
+LineCursor::LineCursor(std::string_view aText) {
+    mChunks.emplace_back(aText);
+}
+
+LineCursor::LineCursor(PageSource aSource, size_t aWindowPages)
+    : mSource {std::move(aSource)}, mWindowPages {std::max<size_t>(aWindowPages, 2)} {}
+
+std::optional<LineCursor::Line> LineCursor::next() {
+    auto line = read(mPosition);
+    dropOldPages();
+    return line;
+}
+
+std::optional<LineCursor::Line> LineCursor::peek() {
+    return lookahead(1);
+}
+
+bool LineCursor::unread() {
+    return retreat(mPosition);
+}
+
+std::optional<LineCursor::Line> LineCursor::lookahead(size_t aCount) {
+    auto position = mPosition;
+    std::optional<Line> line;
+    for (size_t i = 0; i < aCount; ++i) {
+        line = read(position);
+        if (!line) {
+            break;
+        }
+    }
+    return line;
+}
+
+std::optional<LineCursor::Line> LineCursor::lookbehind(size_t aCount) const {
+    auto position = mPosition;
+    for (size_t i = 0; i < aCount; ++i) {
+        if (!retreat(position)) {
+            return std::nullopt;
+        }
+    }
+    return lineAt(position);
+}
+
+bool LineCursor::pull() {
+    if (!mSource) {
+        return false;
+    }
+    auto page = mSource();
+    if (!page) {
+        mSource = nullptr; // Exhausted, never ask again
+        return false;
+    }
+    // Deque elements never move on push_back, views into older pages stay valid
+    mOwnedPages.push_back(std::move(*page));
+    mChunks.emplace_back(mOwnedPages.back());
+    return true;
+}
+
+// Pages before the window behind the cursor are released, lookahead may have pulled pages beyond it
+void LineCursor::dropOldPages() {
+    if (mOwnedPages.empty()) {
+        return;
+    }
+    while (mFirstChunk + mWindowPages <= mPosition.mChunk) {
+        mChunks.pop_front();
+        mOwnedPages.pop_front();
+        ++mFirstChunk;
+    }
+}
+
+std::optional<LineCursor::Line> LineCursor::read(Position& aPosition) {
+    auto position = aPosition;
+    while (true) {
+        if (position.mChunk - mFirstChunk >= mChunks.size()) {
+            if (!pull()) {
+                return std::nullopt; // Position stays at the end of the text
+            }
+            continue;
+        }
+        if (position.mLine < chunk(position.mChunk).size()) {
+            break;
+        }
+        ++position.mChunk;
+        position.mLine = 0;
+    }
+    aPosition = {position.mChunk, position.mLine + 1};
+    return makeLine(chunk(position.mChunk), position.mLine);
+}
+
+bool LineCursor::retreat(Position& aPosition) const {
+    while (aPosition.mLine == 0) {
+        if (aPosition.mChunk == mFirstChunk) {
+            return false;
+        }
+        --aPosition.mChunk;
+        aPosition.mLine = chunk(aPosition.mChunk).size();
+    }
+    --aPosition.mLine;
+    return true;
+}
+
+std::optional<LineCursor::Line> LineCursor::lineAt(Position aPosition) const {
+    if (aPosition.mChunk - mFirstChunk >= mChunks.size() || aPosition.mLine >= chunk(aPosition.mChunk).size()) {
+        return std::nullopt;
+    }
+    return makeLine(chunk(aPosition.mChunk), aPosition.mLine);
+}
+
+LineCursor::Line LineCursor::makeLine(const LineIndex& aLines, size_t aLine) {
+    auto raw = aLines.raw(aLine);
+    if (!raw.starts_with(EXTRACTION_LINE_PREFIX)) {
+        const auto text = aLines.text(aLine);
+        return {raw, text.empty() ? std::string_view {} : text};
+    }
+
+    raw.remove_prefix(EXTRACTION_LINE_PREFIX.size());
+    auto text = raw;
+    const auto begin = text.find_first_not_of(WHITESPACE);
+    if (begin == std::string_view::npos) {
+        return {raw, {}};
+    }
+    text.remove_prefix(begin);
+    text.remove_suffix(text.size() - text.find_last_not_of(WHITESPACE) - 1);
+    return {raw, text};
+}
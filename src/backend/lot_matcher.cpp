@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <numeric>
+
+#include "lot_matcher.hpp"
+
+namespace {
+    // Purchase with units left to sell
+    struct OpenLot {
+        std::uint32_t mRow;
+        double mQuantity;
+    };
+}
+
+LotMatcher LotMatcher::fifo(GainTransactions& aTransactions) {
+    aTransactions.sort();
+    const auto days = aTransactions.days();
+    const auto types = aTransactions.types();
+    const auto quantities = aTransactions.quantities();
+    const auto prices = aTransactions.unitPrices();
+
+    LotMatcher matcher;
+    matcher.mMatches.reserve(aTransactions.size());
+    matcher.mOffsets.reserve(aTransactions.securityCount() + 1);
+    matcher.mOpenQuantities.reserve(aTransactions.securityCount());
+
+    // Reused by every security, the lots before head are sold out
+    std::vector<OpenLot> lots;
+    for (GainTransactions::Security security = 0; security < aTransactions.securityCount(); ++security) {
+        lots.clear();
+        size_t head = 0;
+
+        for (const auto row : aTransactions.rows(security)) {
+            if (types[row] == TradeType::Buy) {
+                if (quantities[row] > 0.0) {
+                    lots.push_back({static_cast<std::uint32_t>(row), quantities[row]});
+                }
+                continue;
+            }
+
+            const auto leftover = QUANTITY_TOLERANCE * quantities[row];
+            auto toSell = quantities[row];
+            while (toSell > leftover && head < lots.size()) {
+                auto& lot = lots[head];
+                const auto sold = std::min(lot.mQuantity, toSell);
+                matcher.mMatches.push_back({lot.mRow, static_cast<std::uint32_t>(row), sold, days[row] - days[lot.mRow],
+                                            sold * (prices[row] - prices[lot.mRow])});
+                lot.mQuantity -= sold;
+                toSell -= sold;
+                if (lot.mQuantity <= QUANTITY_TOLERANCE * quantities[lot.mRow]) {
+                    ++head;
+                }
+            }
+            if (toSell > leftover) {
+                matcher.mUnmatched.push_back({static_cast<std::uint32_t>(row), toSell});
+            }
+        }
+
+        double open = 0.0;
+        for (size_t lot = head; lot < lots.size(); ++lot) {
+            open += lots[lot].mQuantity;
+        }
+        matcher.mOpenQuantities.push_back(open);
+        matcher.mOffsets.push_back(static_cast<std::uint32_t>(matcher.mMatches.size()));
+    }
+    return matcher;
+}
+
+std::span<const LotMatch> LotMatcher::matches(GainTransactions::Security aSecurity) const {
+    return std::span {mMatches}.subspan(mOffsets[aSecurity], mOffsets[aSecurity + 1] - mOffsets[aSecurity]);
+}
+
+double LotMatcher::realizedGain(GainTransactions::Security aSecurity) const {
+    const auto matches = this->matches(aSecurity);
+    return std::accumulate(matches.begin(), matches.end(), 0.0,
+                           [](double aSum, const LotMatch& aMatch) { return aSum + aMatch.mRealizedGain; });
+}
@@ -0,0 +1,43 @@
+#include <algorithm>
+
+#include "raw_text_arena.hpp"
+
+void RawTextArena::reserve(size_t aBytes) {
+    mBuffer.reserve(aBytes);
+}
+
+void RawTextArena::grow(size_t aAdditionalBytes) {
+    const auto required = mBuffer.size() + aAdditionalBytes;
+    if (required <= mBuffer.capacity()) {
+        return;
+    }
+    // Double, but never by less than a chunk, so small pages do not trigger a reallocation each
+    mBuffer.reserve(std::max({required, mBuffer.capacity() * 2, mBuffer.capacity() + MIN_GROWTH_BYTES}));
+}
+
+void RawTextArena::appendPage(int aPage, std::string_view aText) {
+    grow(aText.size() + 1);
+    mPages.push_back({aPage, mBuffer.size(), aText.size()});
+    mBuffer.append(aText);
+    mBuffer.push_back('\n');
+}
+
+void RawTextArena::assign(std::string_view aText) {
+    mBuffer.assign(aText);
+    mPages.assign({{0, 0, aText.size()}});
+}
+
+void RawTextArena::clear() {
+    mBuffer.clear();
+    mPages.clear();
+}
+
+void RawTextArena::release() {
+    std::string {}.swap(mBuffer);
+    std::vector<PageSpan> {}.swap(mPages);
+}
+
+std::string_view RawTextArena::page(size_t aIndex) const {
+    const auto& span = mPages.at(aIndex);
+    return std::string_view {mBuffer}.substr(span.mOffset, span.mLength);
+}
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+#include <nlohmann/json.hpp>
+
+#include "report_grammar.hpp"
+
+namespace {
+    grammar::Vocabulary defaultWords() {
+        grammar::Vocabulary words;
+        for (const auto word : report_lines::words::DEFAULTS) {
+            words.push_back({std::string {word}});
+        }
+        return words;
+    }
+
+    grammar::Vocabulary readWords(const std::filesystem::path& aPath) {
+        const auto fail = [&aPath](const std::string& aReason) {
+            return std::runtime_error {"Invalid report grammar " + aPath.string() + ": " + aReason};
+        };
+
+        std::ifstream file {aPath};
+        if (!file) {
+            throw std::runtime_error {"Cannot open report grammar " + aPath.string()};
+        }
+        const auto json = nlohmann::json::parse(file, nullptr, false);
+        if (!json.is_object() || !json.contains("version") || !json.contains("words") || !json["words"].is_object()) {
+            throw fail("expected an object with \"version\" and \"words\"");
+        }
+        if (json["version"] != ReportGrammar::FILE_VERSION) {
+            throw fail("version " + json["version"].dump() + ", supported is " + std::to_string(ReportGrammar::FILE_VERSION));
+        }
+
+        auto words = defaultWords();
+        for (const auto& [key, alternatives] : json["words"].items()) {
+            const auto& keys = report_lines::words::KEYS;
+            const auto known = std::find(keys.begin(), keys.end(), key);
+            if (known == keys.end()) {
+                throw fail("unknown word \"" + key + "\"");
+            }
+            if (!alternatives.is_array() || alternatives.empty()) {
+                throw fail("\"" + key + "\" must list at least one alternative");
+            }
+
+            auto& replaced = words[static_cast<size_t>(known - keys.begin())];
+            replaced.clear();
+            for (const auto& alternative : alternatives) {
+                if (!alternative.is_string() || alternative.get<std::string>().empty()) {
+                    throw fail("\"" + key + "\" alternatives must be non-empty strings");
+                }
+                replaced.push_back(alternative.get<std::string>());
+            }
+        }
+        return words;
+    }
+}
+
+ReportGrammar::ReportGrammar(grammar::Vocabulary aWords)
+    : mWords {std::move(aWords)},
+      mIncomeTable {report_lines::IncomeLines::table(&mWords)},
+      mGainsTable {report_lines::GainsLines::table(&mWords)},
+      mWithholdingTable {report_lines::WithholdingLines::table(&mWords)},
+      mHistoryTable {report_lines::HistoryLines::table(&mWords)} {
+    for (size_t word = 0; word < mWords.size(); ++word) {
+        for (const auto& printed : mWords[word]) {
+            const auto [entry, added] = mCanonical.try_emplace(printed, report_lines::words::DEFAULTS[word]);
+            if (!added && entry->second != report_lines::words::DEFAULTS[word]) {
+                throw std::runtime_error {"Report grammar: \"" + printed + "\" stands for both \"" + std::string {entry->second} +
+                                          "\" and \"" + std::string {report_lines::words::DEFAULTS[word]} + "\""};
+            }
+        }
+    }
+}
+
+std::shared_ptr<const ReportGrammar> ReportGrammar::standard() {
+    static const std::shared_ptr<const ReportGrammar> grammar {new ReportGrammar {defaultWords()}};
+    return grammar;
+}
+
+std::shared_ptr<const ReportGrammar> ReportGrammar::load(const std::filesystem::path& aPath) {
+    static std::mutex mutex;
+    static std::map<std::filesystem::path, std::shared_ptr<const ReportGrammar>> loaded;
+
+    const auto key = std::filesystem::weakly_canonical(aPath);
+    const std::lock_guard lock {mutex};
+    auto& grammar = loaded[key];
+    if (!grammar) {
+        grammar.reset(new ReportGrammar {readWords(aPath)});
+    }
+    return grammar;
+}
+
+bool ReportGrammar::is(report_lines::words::Id aWord, std::string_view aText) const {
+    const auto& alternatives = mWords[aWord];
+    return std::find(alternatives.begin(), alternatives.end(), aText) != alternatives.end();
+}
+
+bool ReportGrammar::contains(report_lines::words::Id aWord, std::string_view aText) const {
+    const auto& alternatives = mWords[aWord];
+    return std::any_of(alternatives.begin(), alternatives.end(),
+                       [aText](const std::string& aAlternative) { return aText.find(aAlternative) != std::string_view::npos; });
+}
+
+std::string_view ReportGrammar::canonical(std::string_view aWord) const {
+    const auto entry = mCanonical.find(aWord);
+    return entry != mCanonical.end() ? entry->second : aWord;
+}
@@ -2,20 +2,44 @@
 #include <poppler/cpp/poppler-page.h>
 #include <stdexcept>
 #include <ranges>
-#include <regex>
 #include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <deque>
+#include <streambuf>
+#include <map>
+#include <limits>
+#include <cmath>
 
 #include "report_loader.hpp"
+#include "bounded_queue.hpp"
+#include "cell_layout.hpp"
+#include "extraction_cache.hpp"
+#include "mapped_file.hpp"
+#include "raw_text_arena.hpp"
+#include "line_cursor.hpp"
+#include "temp_file.hpp"
+#include "number_parser.hpp"
+#include "report_lines.hpp"
+#include "report_grammar.hpp"
+#include "xml_generator.hpp"
+#include "util_xml.hpp"
 
 #include <iostream>
 
 constexpr size_t RAW_DATA_PAGE_SIZE_BYTES = 1024; // Estimated bytes per page
-inline constexpr auto SECTION_INCOME      = "Detailed Income Section";
-inline constexpr auto SECTION_GAINS       = "Detailed Gains and Losses Section";
-inline constexpr auto SECTION_WITHHOLDING = "Detailed Withholding Tax Section";
-inline constexpr auto SECTION_HISTORY     = "History of Transactions and Corporate Actions";
+constexpr size_t STREAM_QUEUE_CAPACITY_PAGES = 4; // Pages extracted ahead of the parser in Streaming mode
+constexpr size_t STREAM_WINDOW_PAGES = 2;         // Pages kept behind the parser, so it can rewind over a page break
+constexpr int TOC_SCAN_PAGES = 5;                 // The table of contents is searched only on the first pages
+constexpr int TOC_PAGE_MARGIN = 1;                // Extra pages around each section, printed page numbers can drift
+constexpr size_t BOILERPLATE_SAMPLE_PAGES = 6;    // Pages inspected to learn the repeated page header and footer
+constexpr size_t BOILERPLATE_MIN_SAMPLE = 3;      // Fewer sampled pages are not enough to tell boilerplate from content
+constexpr size_t BOILERPLATE_MIN_SHARE = 60;      // Percent of sampled pages a line must appear on to count as boilerplate
+constexpr size_t BOILERPLATE_TOP_LINES = 5;       // Lines searched for the page header block and for the footer
+constexpr size_t BOILERPLATE_BOTTOM_LINES = 1;
 
 // Provide a simple implementation for getNonNegativeDouble to ensure linkage.
 // Returns the value if non-negative, otherwise returns 0.0.
@@ -23,672 +47,1518 @@ double getNonNegativeDouble(const double& v) {
     return (v < 0.0) ? -v : v;
 }
 
-void ReportLoader::getRawPdfData(const std::string& aPdfPath, ProcessingMode aMode) {
-    std::unique_ptr<poppler::document> doc {poppler::document::load_from_file(aPdfPath)};
-    if (!doc) {
-        throw std::runtime_error {"Failed to load PDF: " + aPdfPath};
+namespace {
+    using cell_layout::isDate;
+    using cell_layout::isGroupedNumber;
+    using cell_layout::isLooseNumber;
+    using cell_layout::splitCells;
+
+    size_t utf8Length(std::string_view aText) {
+        return static_cast<size_t>(std::count_if(aText.begin(), aText.end(), [](char c) { return (c & 0xC0) != 0x80; }));
     }
 
-    const auto numPages = doc->pages();
-    if (numPages == 0) {
-        throw std::runtime_error {"PDF has no pages: " + aPdfPath};
+    // Words of the page with their boxes, laid out into lines and cells by cell_layout
+    std::string extractPageCells(const poppler::page& aPage) {
+        std::vector<cell_layout::Word> words;
+        for (const auto& box : aPage.text_list()) {
+            const auto utf8 = box.text().to_utf8();
+            std::string text {utf8.begin(), utf8.end()};
+            if (text.empty() || std::all_of(text.begin(), text.end(), [](unsigned char c) { return std::isspace(c); })) {
+                continue;
+            }
+            const auto rect = box.bbox();
+            const auto charWidth = rect.width() / static_cast<double>(std::max<size_t>(utf8Length(text), 1));
+            words.push_back({std::move(text), rect.left(), rect.right(), rect.y() + rect.height() / 2, rect.height(), charWidth});
+        }
+        return cell_layout::layoutPage(std::move(words));
     }
 
-    clearRawText();
-    mMode = aMode;
+    std::string extractPageText(const poppler::document& aDoc, int aPage, ReportLoader::TextLayout aLayout) {
+        std::unique_ptr<poppler::page> page {aDoc.create_page(aPage)};
+        if (!page) {
+            return {};
+        }
+        if (aLayout == ReportLoader::TextLayout::Cells) {
+            return extractPageCells(*page);
+        }
+        const auto pageText = page->text().to_utf8();
+        return std::string {pageText.begin(), pageText.end()};
+    }
+
+    struct LineSpan {
+        size_t mOffset;
+        size_t mLength; // Without the '\n'
+    };
+
+    // Whitespace runs collapse and digit runs become '#', so "Page 3 of 23" and "Page 4 of 23" share a fingerprint
+    std::string lineFingerprint(std::string_view aLine) {
+        std::string fingerprint;
+        bool pendingSpace {false};
+        for (const unsigned char c : aLine) {
+            if (std::isspace(c)) {
+                pendingSpace = !fingerprint.empty();
+                continue;
+            }
+            if (pendingSpace) {
+                fingerprint += ' ';
+                pendingSpace = false;
+            }
+            if (std::isdigit(c)) {
+                if (fingerprint.empty() || fingerprint.back() != '#') {
+                    fingerprint += '#';
+                }
+                continue;
+            }
+            fingerprint += static_cast<char>(c);
+        }
+        return fingerprint;
+    }
 
-    // Start from page 0 to process all pages
-    constexpr int startPage {0};
-    const auto numPagesToProcess = numPages - startPage;
+    struct GainsRow {
+        std::string mType;
+        std::string mDate;
+        std::string mAmount;
+        std::string mExchangeRate;
+    };
 
-    if (aMode == ProcessingMode::InMemory) {
-        mRawText.reserve(numPagesToProcess * RAW_DATA_PAGE_SIZE_BYTES);
+    // "Trading Buy|Trading Sell  date  amount  exchange rate", from cells when the line has them
+    bool isTradeType(const ReportGrammar& aGrammar, std::string_view aCell) {
+        return aGrammar.is(report_lines::words::TRADING_BUY, aCell) || aGrammar.is(report_lines::words::TRADING_SELL, aCell);
+    }
 
-        bool hasContent {false};
-        for (const auto i : std::views::iota(startPage, numPages)) {
-            std::unique_ptr<poppler::page> page {doc->create_page(i)};
-            if (!page) {
-                continue;
+    std::optional<GainsRow> matchGainsRow(const ReportGrammar& aGrammar, std::string_view aLine, const report_lines::GainsLines::Result& aClassified) {
+        if (const auto cells = splitCells(aLine); !cells.empty()) {
+            if (cells.size() == 4 && isTradeType(aGrammar, cells[0]) && isDate(cells[1]) && isGroupedNumber(cells[2]) &&
+                isGroupedNumber(cells[3])) {
+                return GainsRow {std::string {aGrammar.canonical(cells[0])}, std::string {cells[1]}, std::string {cells[2]},
+                                 std::string {cells[3]}};
             }
-            const auto pageText = page->text().to_utf8();
-            std::string text {pageText.begin(), pageText.end()};
-            if (!text.empty()) {
-                mRawText += text + "\n";
-                hasContent = true;
+            return std::nullopt;
+        }
+
+        if (!aClassified.is<report_lines::GainsTransactionLine>()) {
+            return std::nullopt;
+        }
+        return GainsRow {std::string {aGrammar.canonical(aClassified[1])}, aClassified.str(2), aClassified.str(3), aClassified.str(4)};
+    }
+
+    struct HistoryRow {
+        std::string mType;
+        std::string mTransactionDate;
+        std::string mValueDate;
+        std::string mExchangeRate;
+        std::string mAmount;
+        std::string mMarketValue;
+    };
+
+    // "Trading Buy|Trading Sell  date  value date  EUR  rate  amount  market value  fees", from cells when the line has them
+    std::optional<HistoryRow> matchHistoryRow(const ReportGrammar& aGrammar, std::string_view aLine,
+                                              const report_lines::HistoryLines::Result& aClassified) {
+        if (const auto cells = splitCells(aLine); !cells.empty()) {
+            if (cells.size() == 8 && isTradeType(aGrammar, cells[0]) && isDate(cells[1]) &&
+                isDate(cells[2]) && cells[3] == "EUR" && isLooseNumber(cells[4], false) && isLooseNumber(cells[5], true) &&
+                isLooseNumber(cells[6], false) && isLooseNumber(cells[7], false)) {
+                return HistoryRow {std::string {aGrammar.canonical(cells[0])}, std::string {cells[1]}, std::string {cells[2]},
+                                   std::string {cells[4]}, std::string {cells[5]}, std::string {cells[6]}};
             }
+            return std::nullopt;
         }
 
-        if (!hasContent) {
-            throw std::runtime_error {"No text extracted from PDF: " + aPdfPath};
+        if (!aClassified.is<report_lines::HistoryTransactionLine>()) {
+            return std::nullopt;
         }
-    } 
-    else if (aMode == ProcessingMode::FileBased) {
-        // Generate a unique temporary file name
-        auto tempDir = std::filesystem::temp_directory_path();
-        auto uniqueSuffix = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
-        mTempFilePath = (tempDir / ("pdf_extract_" + uniqueSuffix + ".txt")).string();
-        std::ofstream tempFile {mTempFilePath, std::ios::binary};
-        if (!tempFile) {
-            throw std::runtime_error {"Failed to create temporary file: " + mTempFilePath};
+        return HistoryRow {std::string {aGrammar.canonical(aClassified[1])}, aClassified.str(2), aClassified.str(3), aClassified.str(4),
+                           aClassified.str(5), aClassified.str(6)};
+    }
+
+    // "ISIN - Name" with a single space around the dash, however the line spaced it
+    template <typename Match>
+    std::string isinText(const Match& aMatch) {
+        return aMatch.str(1) + " - " + aMatch.str(2);
+    }
+
+    std::string_view trimSpaces(std::string_view aLine) {
+        const auto isSpace = [](char c) { return grammar::SpaceChars::contains(c); };
+        while (!aLine.empty() && isSpace(aLine.front())) aLine.remove_prefix(1);
+        while (!aLine.empty() && isSpace(aLine.back())) aLine.remove_suffix(1);
+        return aLine;
+    }
+
+    // Page header and footer lines: the "Client:", "Period:", "Currency:", "Country:" block a page starts with, every
+    // label once, and the "Report ID:" line it ends with. No other line is ever boilerplate, so data rows repeated at
+    // the top or bottom of every page are kept
+    std::vector<LineSpan> pageFurnitureLines(std::string_view aPageText, const ReportGrammar& aGrammar) {
+        std::vector<LineSpan> lines;
+        for (size_t start = 0; start < aPageText.size();) {
+            const auto end = std::min(aPageText.find('\n', start), aPageText.size());
+            if (!trimSpaces(aPageText.substr(start, end - start)).empty()) {
+                lines.push_back({start, end - start});
+            }
+            start = end + 1;
+        }
+        const auto text = [aPageText](const LineSpan& aLine) { return trimSpaces(aPageText.substr(aLine.mOffset, aLine.mLength)); };
+
+        std::vector<LineSpan> furniture;
+        std::set<std::string> labels;
+        const auto headerEnd = std::min(lines.size(), BOILERPLATE_TOP_LINES);
+        size_t line {0};
+        for (; line < headerEnd; ++line) {
+            const auto header = aGrammar.match<report_lines::HeaderLine>(text(lines[line]));
+            if (!header || !labels.insert(header->str(1)).second) {
+                break;
+            }
+            furniture.push_back(lines[line]);
         }
+        for (auto footer = std::max(line, lines.size() - std::min(lines.size(), BOILERPLATE_BOTTOM_LINES)); footer < lines.size(); ++footer) {
+            if (aGrammar.match<report_lines::ReportIdLine>(text(lines[footer]))) {
+                furniture.push_back(lines[footer]);
+            }
+        }
+        return furniture;
+    }
 
-        bool hasContent = false;
-        for (const auto i : std::views::iota(startPage, numPages)) {
-            std::unique_ptr<poppler::page> page {doc->create_page(i)};
-            if (!page) {
+    struct TocEntry {
+        std::string mTitle;
+        int mPage; // Printed page number, 1 based
+    };
+
+    // Parse "V            Detailed Income Section                                               8" rows after the TOC title
+    std::vector<TocEntry> parseTableOfContents(const ReportGrammar& aGrammar, const std::string& aPageText) {
+        std::vector<TocEntry> entries;
+        std::istringstream iss {aPageText};
+        std::string line;
+        bool inToc {false};
+
+        while (std::getline(iss, line)) {
+            if (!inToc) {
+                inToc = aGrammar.contains(report_lines::words::TABLE_OF_CONTENT, line);
                 continue;
             }
-            const auto pageText = page->text().to_utf8();
-            std::string text {pageText.begin(), pageText.end()};
-            if (!text.empty()) {
-                tempFile << text << "\n";
-                hasContent = true;
+
+            if (const auto match = aGrammar.match<report_lines::TocEntryLine>(trimSpaces(line))) {
+                entries.push_back({match->str(1), std::stoi(match->str(2))});
             }
         }
+        return entries;
+    }
 
-        tempFile.close();  // TODO: some mutex when will be in use, currently is not
+    // Titles of the "VI. Detailed Gains and Losses Section" style headers on a page, in order
+    std::vector<std::string> sectionHeaders(const ReportGrammar& aGrammar, const std::string& aPageText) {
+        std::vector<std::string> headers;
+        std::istringstream iss {aPageText};
+        std::string line;
+
+        while (std::getline(iss, line)) {
+            if (const auto match = aGrammar.match<report_lines::SectionLine>(trimSpaces(line))) {
+                headers.push_back(match->str(2));
+            }
+        }
+        return headers;
+    }
 
-        if (!hasContent) {
-            std::filesystem::remove(mTempFilePath);
-            mTempFilePath.clear();
-            throw std::runtime_error {"No text extracted from PDF: " + aPdfPath};
+    bool isSectionTitle(const ReportGrammar& aGrammar, ReportLoader::ReportSection aSection, std::string_view aTitle) {
+        using namespace report_lines;
+        switch (aSection) {
+            case ReportLoader::ReportSection::Income:             return aGrammar.is(words::SECTION_INCOME, aTitle);
+            case ReportLoader::ReportSection::GainsAndLosses:     return aGrammar.is(words::SECTION_GAINS, aTitle);
+            case ReportLoader::ReportSection::WithholdingTax:     return aGrammar.is(words::SECTION_WITHHOLDING, aTitle);
+            case ReportLoader::ReportSection::TransactionHistory: return aGrammar.is(words::SECTION_HISTORY, aTitle);
+        }
+        return false;
+    }
+
+    // Detailed section a heading title opens, if any
+    std::optional<ReportLoader::ReportSection> detailedSection(const ReportGrammar& aGrammar, std::string_view aTitle) {
+        using ReportSection = ReportLoader::ReportSection;
+        for (const auto section : {ReportSection::Income, ReportSection::GainsAndLosses, ReportSection::WithholdingTax,
+                                   ReportSection::TransactionHistory}) {
+            if (isSectionTitle(aGrammar, section, aTitle)) {
+                return section;
+            }
+        }
+        return std::nullopt;
+    }
+}
+
+void ReportLoader::getRawPdfData(const std::string& aPdfPath, ProcessingMode aMode) {
+    // One mapping of the input serves the cache key, the table of content probe and the extraction
+    std::shared_ptr<const MappedFile> mapping;
+    try {
+        mapping = std::make_shared<const MappedFile>(aPdfPath);
+    } catch (const std::runtime_error&) {
+        throw std::runtime_error {"Failed to load PDF: " + aPdfPath};
+    }
+
+    const auto bytes = std::as_bytes(std::span {mapping->view()});
+    loadPdf(bytes, aPdfPath, aMode, std::move(mapping));
+}
+
+void ReportLoader::getRawPdfData(std::span<const std::byte> aPdfData, ProcessingMode aMode) {
+    loadPdf(aPdfData, "<memory buffer>", aMode, nullptr);
+}
+
+void ReportLoader::loadPdf(std::span<const std::byte> aPdfData, const std::string& aPdfName, ProcessingMode aMode,
+                           std::shared_ptr<const MappedFile> aMapping) {
+    clearRawText();
+    mMode = aMode;
+    mPdfName = aPdfName;
+    mPdfData = aPdfData;
+    mMappedPdf = std::move(aMapping);
+
+    // poppler takes the buffer length as int
+    if (aPdfData.size() > static_cast<size_t>(std::numeric_limits<int>::max())) {
+        throw std::runtime_error {"PDF is too large to load: " + aPdfName};
+    }
+
+    // A cached entry knows the page count, so a fully cached report never opens poppler
+    std::optional<int> cachedPageCount;
+    if (mCache) {
+        mCacheKey = ExtractionCache::makeKey({reinterpret_cast<const char*>(aPdfData.data()), aPdfData.size()}, EXTRACTOR_VERSION,
+                                             mTextLayout == TextLayout::Cells ? "cells" : "");
+        cachedPageCount = mCache->loadPageCount(mCacheKey);
+    }
+
+    const auto numPages = cachedPageCount ? *cachedPageCount : document().pages();
+    if (numPages == 0) {
+        throw std::runtime_error {"PDF has no pages: " + aPdfName};
+    }
+    if (mCache && !mCacheKey.empty() && !cachedPageCount) {
+        mCache->storePageCount(mCacheKey, numPages);
+    }
+
+    const DocumentAccess documentAccess = [this]() -> const poppler::document& { return document(); };
+    selectPages(numPages, documentAccess);
+    detectBoilerplate(documentAccess);
+
+    // Auto keeps the text in memory while it fits into the budget and spills to a file once it does not
+    const bool spillOverBudget = aMode == ProcessingMode::Auto;
+    // A caller's buffer stays resident for the whole job, a mapping is file backed and can be reclaimed
+    const size_t residentInput = mMappedPdf ? 0 : aPdfData.size();
+    if (aMode == ProcessingMode::Auto) {
+        aMode = autoMode(residentInput);
+        mMode = aMode;
+    }
+
+    if (aMode == ProcessingMode::InMemory) {
+        if (!extractInMemory(documentAccess, spillOverBudget, residentInput)) {
+            throw std::runtime_error {"No text extracted from PDF: " + aPdfName};
+        }
+    } 
+    else if (aMode == ProcessingMode::FileBased) {
+        if (!extractToFile(documentAccess)) {
+            throw std::runtime_error {"No text extracted from PDF: " + aPdfName};
+        }
+    }
+    else if (aMode == ProcessingMode::Streaming) {
+        // Pages are extracted lazily by convertToJson, the document stays open until then
+    }
+    else if (aMode == ProcessingMode::Parallel) {
+        const auto pages = extractPagesParallel(documentAccess);
+
+        // Merge in page order, so the text is byte identical to the sequential InMemory path
+        size_t totalSize {0};
+        for (const auto& text : pages) {
+            totalSize += text.empty() ? 0 : text.size() + 1;
+        }
+        mRawText.reserve(totalSize);
+
+        for (size_t i = 0; i < pages.size(); ++i) {
+            if (!pages[i].empty()) {
+                mRawText.appendPage(mSelection.mPages[i], pages[i]);
+            }
+        }
+
+        if (mRawText.empty()) {
+            throw std::runtime_error {"No text extracted from PDF: " + aPdfName};
         }
     }
     else {
         throw std::runtime_error {"Unknown processing aMode"};
     }
 
+    if (aMode != ProcessingMode::Streaming) {
+        // The text is extracted, neither the document nor the input bytes are needed anymore
+        mDocument.reset();
+        mPdfData = {};
+        mMappedPdf.reset();
+        if (mCache && !cachedPageCount) {
+            mCache->trim();
+        }
+    }
+}
+
+ReportLoader::ProcessingMode ReportLoader::autoMode(size_t aResidentInput) const {
+    const size_t estimatedBytes = mSelection.mPages.size() * RAW_DATA_PAGE_SIZE_BYTES + aResidentInput;
+    return estimatedBytes <= mMemoryBudget ? ProcessingMode::InMemory : ProcessingMode::FileBased;
+}
+
+bool ReportLoader::extractInMemory(const DocumentAccess& aDocument, bool aSpillOverBudget, size_t aResidentInput) {
+    const size_t reserveBytes = mSelection.mPages.size() * RAW_DATA_PAGE_SIZE_BYTES;
+    mRawText.reserve(aSpillOverBudget ? std::min(reserveBytes, mMemoryBudget) : reserveBytes);
+
+    std::ofstream spillFile {};
+    bool hasContent {false};
+    for (const auto i : mSelection.mPages) {
+        std::string text {selectedPageText(aDocument, i, mStrippedBytes)};
+        if (text.empty()) {
+            continue;
+        }
+        hasContent = true;
+
+        if (spillFile.is_open()) {
+            spillFile << text << "\n";
+            continue;
+        }
+
+        mRawText.appendPage(i, text);
+        if (aSpillOverBudget && mRawText.size() + aResidentInput > mMemoryBudget) {
+            // The estimate was too low, move what we have to a file and continue there as FileBased
+            spillFile = createTempFile();
+            spillFile << mRawText.view();
+            mRawText.release();
+            mMode = ProcessingMode::FileBased;
+        }
+    }
+
+    if (spillFile.is_open()) {
+        spillFile.close();
+        if (!spillFile) {
+            throw std::runtime_error {"Failed to write temporary file: " + mTempFile.path().string()};
+        }
+    }
+    return hasContent;
+}
+
+bool ReportLoader::extractToFile(const DocumentAccess& aDocument) {
+    std::ofstream tempFile {createTempFile()};
+
+    bool hasContent = false;
+    for (const auto i : mSelection.mPages) {
+        std::string text {selectedPageText(aDocument, i, mStrippedBytes)};
+        if (!text.empty()) {
+            tempFile << text << "\n";
+            hasContent = true;
+        }
+    }
+
+    tempFile.close();
+
+    if (!hasContent) {
+        mTempFile.remove();
+    }
+    return hasContent;
+}
+
+std::ofstream ReportLoader::createTempFile() {
+    // The file is created exclusively, so loaders starting at the same moment never write into each other's file
+    mTempFile = TempFile {std::filesystem::temp_directory_path(), "pdf_extract_"};
+    std::ofstream tempFile {mTempFile.path(), std::ios::binary | std::ios::trunc};
+    if (!tempFile) {
+        throw std::runtime_error {"Failed to create temporary file: " + mTempFile.path().string()};
+    }
+    return tempFile;
+}
+
+ReportLoader::ReportLoader() : mGrammar {ReportGrammar::standard()} {}
+
+void ReportLoader::setThreadCount(unsigned aThreadCount) {
+    mThreadCount = aThreadCount;
+}
+
+void ReportLoader::setRequiredSections(std::set<ReportSection> aSections) {
+    mRequiredSections = std::move(aSections);
+}
+
+void ReportLoader::setGrammar(std::shared_ptr<const ReportGrammar> aGrammar) {
+    mGrammar = aGrammar ? std::move(aGrammar) : ReportGrammar::standard();
+}
+
+void ReportLoader::setStripBoilerplate(bool aStrip) {
+    mStripBoilerplate = aStrip;
+}
+
+void ReportLoader::setParallelSections(bool aParallel) {
+    mParallelSections = aParallel;
+}
+
+size_t ReportLoader::strippedBytes() const {
+    return mStrippedBytes;
+}
+
+void ReportLoader::setTextLayout(TextLayout aLayout) {
+    mTextLayout = aLayout;
+}
+
+void ReportLoader::setMemoryBudget(size_t aBytes) {
+    mMemoryBudget = aBytes;
+}
+
+ReportLoader::ProcessingMode ReportLoader::processingMode() const {
+    return mMode;
+}
+
+void ReportLoader::setExtractionCache(std::shared_ptr<const ExtractionCache> aCache) {
+    mCache = std::move(aCache);
+}
+
+void ReportLoader::selectPages(int aNumPages, const DocumentAccess& aDocument) {
+    const int numPages = aNumPages;
+    auto& selection = mSelection;
+
+    auto allPages = [&]() {
+        selection.mPages.clear();
+        for (const auto i : std::views::iota(0, numPages)) {
+            selection.mPages.push_back(i);
+        }
+    };
+
+    if (mRequiredSections.empty()) {
+        return allPages();
+    }
+
+    auto prefetch = [&](int aPage) -> const std::string& {
+        auto it = selection.mPrefetched.find(aPage);
+        if (it == selection.mPrefetched.end()) {
+            it = selection.mPrefetched.emplace(aPage, loadPageText(aDocument, aPage)).first;
+        }
+        return it->second;
+    };
+
+    // Locate the table of contents on the first pages
+    std::vector<TocEntry> toc;
+    int tocPage {-1};
+    for (const auto i : std::views::iota(0, std::min(TOC_SCAN_PAGES, numPages))) {
+        toc = parseTableOfContents(*mGrammar, prefetch(i));
+        if (!toc.empty()) {
+            tocPage = i;
+            break;
+        }
+    }
+    if (tocPage < 0) {
+        return allPages();
+    }
+
+    // Front matter (client, period, ...) is always needed for the header
+    std::vector<bool> needed(numPages, false);
+    std::fill(needed.begin(), needed.begin() + tocPage + 1, true);
+
+    for (const auto section : mRequiredSections) {
+        const auto isTitle = [&](const std::string& aTitle) { return isSectionTitle(*mGrammar, section, aTitle); };
+        const auto entry = std::find_if(toc.begin(), toc.end(), [&](const TocEntry& e) { return isTitle(e.mTitle); });
+        if (entry == toc.end()) {
+            return allPages();
+        }
+
+        const auto next = std::next(entry);
+        const int first = std::clamp(entry->mPage - 1 - TOC_PAGE_MARGIN, 0, numPages - 1);
+        const int last = std::clamp((next != toc.end() ? next->mPage - 1 : numPages - 1) + TOC_PAGE_MARGIN, 0, numPages - 1);
+        if (first > last) {
+            return allPages();
+        }
+
+        // The range must open before the section starts and close after it ends, otherwise the TOC can not be trusted.
+        // Detailed sections repeat their header on every page, so a closing page without any header
+        // belongs to a trailing part like the explanatory notes.
+        const auto firstHeaders = sectionHeaders(*mGrammar, prefetch(first));
+        const bool startsBefore = first <= tocPage || (!firstHeaders.empty() && !isTitle(firstHeaders.front()));
+        const auto lastHeaders = sectionHeaders(*mGrammar, prefetch(last));
+        const bool endsAfter = last == numPages - 1 || lastHeaders.empty() || !isTitle(lastHeaders.back());
+        if (!startsBefore || !endsAfter) {
+            return allPages();
+        }
+
+        std::fill(needed.begin() + first, needed.begin() + last + 1, true);
+    }
+
+    for (const auto i : std::views::iota(0, numPages)) {
+        if (needed[i]) {
+            selection.mPages.push_back(i);
+        }
+    }
+
+    // Drop prefetched pages that turned out not to be needed
+    std::erase_if(selection.mPrefetched, [&](const auto& aEntry) { return !needed[aEntry.first]; });
+}
+
+std::string ReportLoader::selectedPageText(const DocumentAccess& aDocument, int aPage, size_t& aStrippedBytes) {
+    std::string text;
+    // Pages read while planning the selection are not extracted twice
+    if (auto it = mSelection.mPrefetched.find(aPage); it != mSelection.mPrefetched.end()) {
+        text = std::move(it->second);
+    } else {
+        text = loadPageText(aDocument, aPage);
+    }
+    aStrippedBytes += stripBoilerplate(aPage, text);
+    return text;
+}
+
+void ReportLoader::detectBoilerplate(const DocumentAccess& aDocument) {
+    if (!mStripBoilerplate) {
+        return;
+    }
+
+    const auto sampleSize = std::min(BOILERPLATE_SAMPLE_PAGES, mSelection.mPages.size());
+    if (sampleSize < BOILERPLATE_MIN_SAMPLE) {
+        return;
+    }
+
+    // fingerprint -> (number of sampled pages with it on their edge, first of those pages)
+    std::map<std::string, std::pair<size_t, int>> occurrences;
+    for (size_t i = 0; i < sampleSize; ++i) {
+        const int page = mSelection.mPages[i];
+        auto it = mSelection.mPrefetched.find(page);
+        if (it == mSelection.mPrefetched.end()) {
+            it = mSelection.mPrefetched.emplace(page, loadPageText(aDocument, page)).first;
+        }
+
+        std::set<std::string> pageFingerprints;
+        for (const auto& line : pageFurnitureLines(it->second, *mGrammar)) {
+            pageFingerprints.insert(lineFingerprint(std::string_view {it->second}.substr(line.mOffset, line.mLength)));
+        }
+        for (auto& fingerprint : pageFingerprints) {
+            auto& [count, firstPage] = occurrences.try_emplace(fingerprint, 0, page).first->second;
+            ++count;
+        }
+    }
+
+    for (auto& [fingerprint, occurrence] : occurrences) {
+        if (occurrence.first >= 2 && occurrence.first * 100 >= sampleSize * BOILERPLATE_MIN_SHARE) {
+            mSelection.mBoilerplate.emplace(fingerprint, occurrence.second);
+        }
+    }
+}
+
+size_t ReportLoader::stripBoilerplate(int aPage, std::string& aText) const {
+    if (mSelection.mBoilerplate.empty()) {
+        return 0;
+    }
+
+    std::vector<LineSpan> removed;
+    for (const auto& line : pageFurnitureLines(aText, *mGrammar)) {
+        const auto it = mSelection.mBoilerplate.find(lineFingerprint(std::string_view {aText}.substr(line.mOffset, line.mLength)));
+        // The first page with the line keeps it, e.g. the client number for parseHeader
+        if (it != mSelection.mBoilerplate.end() && it->second != aPage) {
+            removed.push_back(line);
+        }
+    }
+    if (removed.empty()) {
+        return 0;
+    }
+
+    std::string stripped;
+    stripped.reserve(aText.size());
+    size_t start {0};
+    for (const auto& line : removed) {
+        stripped.append(aText, start, line.mOffset - start);
+        start = std::min(line.mOffset + line.mLength + 1, aText.size()); // Line including its '\n'
+    }
+    stripped.append(aText, start);
+
+    const auto strippedBytes = aText.size() - stripped.size();
+    aText = std::move(stripped);
+    return strippedBytes;
+}
+
+std::string ReportLoader::loadPageText(const DocumentAccess& aDocument, int aPage) const {
+    if (mCache && !mCacheKey.empty()) {
+        if (auto cached = mCache->loadPage(mCacheKey, aPage)) {
+            return std::move(*cached);
+        }
+    }
+
+    std::string text {extractPageText(aDocument(), aPage, mTextLayout)};
+    if (mCache && !mCacheKey.empty()) {
+        mCache->storePage(mCacheKey, aPage, text);
+    }
+    return text;
+}
+
+const poppler::document& ReportLoader::document() {
+    if (!mDocument) {
+        mDocument = openDocument();
+    }
+    return *mDocument;
+}
+
+std::unique_ptr<poppler::document> ReportLoader::openDocument() const {
+    // poppler reads the caller's buffer in place, it must outlive the document
+    std::unique_ptr<poppler::document> doc {
+        poppler::document::load_from_raw_data(reinterpret_cast<const char*>(mPdfData.data()), static_cast<int>(mPdfData.size()))};
+    if (!doc) {
+        throw std::runtime_error {"Failed to load PDF: " + mPdfName};
+    }
+    return doc;
+}
+
+std::vector<std::string> ReportLoader::extractPagesParallel(const DocumentAccess& aDocument) {
+    const int numPages = static_cast<int>(mSelection.mPages.size());
+    const unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    const auto numWorkers = static_cast<int>(std::clamp(mThreadCount == 0 ? hardwareThreads : mThreadCount, 1u, static_cast<unsigned>(numPages)));
+
+    // Split selected pages into contiguous ranges, first ranges take the remainder
+    std::vector<std::pair<int, int>> ranges;
+    ranges.reserve(numWorkers);
+    const int pagesPerWorker = numPages / numWorkers;
+    const int remainder = numPages % numWorkers;
+    for (int w = 0, first = 0; w < numWorkers; ++w) {
+        const int last = first + pagesPerWorker + (w < remainder ? 1 : 0);
+        ranges.emplace_back(first, last);
+        first = last;
+    }
+
+    std::vector<std::string> pages(numPages);
+    std::vector<std::exception_ptr> errors(numWorkers);
+    std::vector<size_t> strippedBytes(numWorkers, 0);
+
+    auto extractRange = [&](const DocumentAccess& aWorkerDocument, int aWorker) {
+        for (const auto i : std::views::iota(ranges[aWorker].first, ranges[aWorker].second)) {
+            pages[i] = selectedPageText(aWorkerDocument, mSelection.mPages[i], strippedBytes[aWorker]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(numWorkers - 1);
+    for (int w = 1; w < numWorkers; ++w) {
+        workers.emplace_back([&, w] {
+            try {
+                // poppler objects are not safe to share, so every worker opens its own document handle,
+                // only once it meets a page that is not prefetched or cached
+                std::unique_ptr<poppler::document> workerDoc {};
+                const DocumentAccess workerDocument = [&]() -> const poppler::document& {
+                    if (!workerDoc) {
+                        workerDoc = openDocument();
+                    }
+                    return *workerDoc;
+                };
+                extractRange(workerDocument, w);
+            } catch (...) {
+                errors[w] = std::current_exception();
+            }
+        });
+    }
+
+    // The calling thread reuses the loader's document for the first range
+    try {
+        extractRange(aDocument, 0);
+    } catch (...) {
+        errors[0] = std::current_exception();
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    for (const auto bytes : strippedBytes) {
+        mStrippedBytes += bytes;
+    }
+    return pages;
 }
 
 nlohmann::json ReportLoader::convertToJson() {
-    std::istringstream iss {};
-    if (mMode == ProcessingMode::InMemory) {
+    auto state = parseLoaded();
+    return toJson(state);
+}
+
+Transactions ReportLoader::convertToTransactions(const std::set<TransactionType>& aTypes) {
+    auto state = parseLoaded();
+    return toTransactions(state, aTypes);
+}
+
+ReportLoader::ParseState ReportLoader::parseLoaded() {
+    if (mMode == ProcessingMode::Streaming) {
+        return parseStream();
+    }
+
+    if (mMode == ProcessingMode::InMemory || mMode == ProcessingMode::Parallel) {
         if (mRawText.empty()) {
             throw std::runtime_error {"No raw text available to convert to JSON"};
         }
 
-        iss.str(mRawText);
+        if (mParallelSections) {
+            return parseReportBySection(mRawText.view());
+        }
+        LineCursor cursor {mRawText.view()};
+        return parseReport(cursor);
     }
     else if (mMode == ProcessingMode::FileBased) {
-        if (mTempFilePath.empty()) {
+        if (mTempFile.empty()) {
             throw std::runtime_error {"No temporary file available to convert to JSON"};
         }
 
-        std::ifstream file {mTempFilePath};
-        if (!file) {
-            throw std::runtime_error {"Failed to open temporary file: " + mTempFilePath};
+        // Parse straight from the mapping, the file contents are never copied into a string
+        const MappedFile file {mTempFile.path()};
+        if (mParallelSections) {
+            return parseReportBySection(file.view());
         }
-
-        // Read the entire file into a string
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        std::string fileContent = buffer.str();
-        file.close();
-
-        iss.str(fileContent);
+        LineCursor cursor {file.view()};
+        return parseReport(cursor);
     }
     else {
         throw std::runtime_error {"Unknown processing aMode"};
     }
+}
+
+ReportLoader::ParseState ReportLoader::parseStream() {
+    ParseState result;
+    streamSelection([&](LineCursor& aCursor) { result = parseReport(aCursor); });
+    return result;
+}
+
+void ReportLoader::streamSelection(const std::function<void(LineCursor&)>& aConsume) {
+    if (mSelection.mPages.empty()) {
+        throw std::runtime_error {"No document available to stream to JSON"};
+    }
+
+    const DocumentAccess documentAccess = [this]() -> const poppler::document& { return document(); };
+
+    BoundedQueue<std::string> pageQueue {STREAM_QUEUE_CAPACITY_PAGES};
+    std::exception_ptr producerError {};
+    bool hasContent {false};
+    size_t strippedBytes {0};
+
+    // Producer: extract pages and hand them over to the parser while it works on the previous ones
+    std::thread producer {[&] {
+        try {
+            for (const auto i : mSelection.mPages) {
+                std::string text {selectedPageText(documentAccess, i, strippedBytes)};
+                if (text.empty()) {
+                    continue;
+                }
+                text += '\n';
+                hasContent = true;
+                if (!pageQueue.push(std::move(text))) {
+                    break; // Parser stopped early
+                }
+            }
+        } catch (...) {
+            producerError = std::current_exception();
+        }
+        pageQueue.close();
+    }};
+
+    {
+        // Closes the queue before joining however parsing ends, a producer waiting in push() would otherwise never return
+        struct ProducerShutdown {
+            BoundedQueue<std::string>& mQueue;
+            std::thread& mProducer;
+            ~ProducerShutdown() {
+                mQueue.close();
+                mProducer.join();
+            }
+        } shutdown {pageQueue, producer};
+
+        LineCursor cursor {[&pageQueue] { return pageQueue.pop(); }, STREAM_WINDOW_PAGES};
+        aConsume(cursor);
+    }
+
+    mStrippedBytes = strippedBytes;
+
+    if (mCache) {
+        mCache->trim();
+    }
 
-    nlohmann::json result;
-    std::vector<nlohmann::json> incomeSections;
-    std::vector<nlohmann::json> gainsAndLossesSections;
-    std::vector<nlohmann::json> withholdingTaxSections;
-    std::vector<nlohmann::json> transactionHistory;
+    if (producerError) {
+        std::rethrow_exception(producerError);
+    }
+    if (!hasContent) {
+        throw std::runtime_error {"No text extracted from PDF"};
+    }
+}
+
+ReportLoader::ParseState ReportLoader::parseReport(LineCursor& aCursor) const {
+    ParseState state;
+    parseSections(aCursor, state);
+    return state;
+}
 
+void ReportLoader::parseSections(LineCursor& aCursor, ParseState& aState) const {
     std::string currentSection;
-    std::regex sectionRegex(R"(^([IVX]+\.)\s+(.+)$)");
+    std::optional<ReportSection> detailed;
+
+    auto isRequired = [this](ReportSection aSection) {
+        return mRequiredSections.empty() || mRequiredSections.contains(aSection);
+    };
 
-    while (auto line = extractLine(iss)) {
-        std::string trimmedLine = trim(*line);
+    while (const auto line = aCursor.next()) {
+        const auto trimmedLine = line->mText;
         if (trimmedLine.empty()) continue;
 
-        std::smatch m;
-        if (std::regex_match(trimmedLine, m, sectionRegex)) {
-            currentSection = m[2].str();
+        if (const auto section = mGrammar->match<report_lines::SectionLine>(trimmedLine)) {
+            currentSection = section->str(2);
+            detailed = detailedSection(*mGrammar, currentSection);
             continue;
         }
 
         if (currentSection.empty()) {
-            parseHeader(iss, result);
+            parseHeader(aCursor, aState.mHeader);
             continue;
         }
 
-        (currentSection == SECTION_INCOME)      ? parseIncomeSection(iss, incomeSections) :
-        (currentSection == SECTION_GAINS)       ? parseGainsAndLossesSection(iss, gainsAndLossesSections) :
-        (currentSection == SECTION_WITHHOLDING) ? parseWithholdingTaxSection(iss, withholdingTaxSections) :
-        (currentSection == SECTION_HISTORY)     ? parseTransactionHistorySection(iss, transactionHistory) :
+        (detailed == ReportSection::Income             && isRequired(ReportSection::Income))             ? parseIncomeSection(aCursor, aState.mIncome, aState.mLastIncomeIsin) :
+        (detailed == ReportSection::GainsAndLosses     && isRequired(ReportSection::GainsAndLosses))     ? parseGainsAndLossesSection(aCursor, aState.mGainsPages) :
+        (detailed == ReportSection::WithholdingTax     && isRequired(ReportSection::WithholdingTax))     ? parseWithholdingTaxSection(aCursor, aState.mWithholding) :
+        (detailed == ReportSection::TransactionHistory && isRequired(ReportSection::TransactionHistory)) ? parseTransactionHistorySection(aCursor, aState.mHistoryPages) :
                                         ((void)0);
     }
+}
+
+nlohmann::json ReportLoader::toJson(ParseState& aState) const {
+    nlohmann::json result = std::move(aState.mHeader);
+
+    result["income_section"] = nlohmann::json::array();
+    for (const auto& income : aState.mIncome) {
+        nlohmann::json section;
+        section["asset_type"] = income.mAssetType;
+        section["country"] = income.mCountry;
+        section["transactions"] = nlohmann::json::array();
+        double grossIncome = 0.0;
+        double netIncome = 0.0;
+        for (const auto& row : income.mTransactions) {
+            nlohmann::json transaction;
+            if (!row.mDeposit) {
+                transaction["isin"] = row.mIsin;
+                transaction["withholding_tax"] = row.mWithholdingTax;
+            }
+            transaction["DEPOSIT"] = row.mDeposit;
+            transaction["transaction_type"] = row.mType;
+            transaction["value_date"] = row.mValueDate;
+            transaction["amount_of_units"] = row.mAmount;
+            transaction["exchange_rate"] = row.mExchangeRate;
+            transaction["gross_income"] = row.mGrossIncome;
+            transaction["net_income"] = row.mNetIncome;
+            section["transactions"].push_back(std::move(transaction));
+            grossIncome += row.mGrossIncome;
+            netIncome += row.mNetIncome;
+        }
+        section["totals"]["gross_income"] = grossIncome;
+        section["totals"]["net_income"] = netIncome;
+        result["income_section"].push_back(std::move(section));
+    }
 
-    result["income_section"] = incomeSections;
-    result["gains_and_losses_section"] = gainsAndLossesSections;
-    result["withholding_tax_section"] = withholdingTaxSections;
-    result["transaction_history"] = transactionHistory;
+    result["gains_and_losses_section"] = nlohmann::json::array();
+    for (const auto& gains : joinGainsPages(aState.mGainsPages)) {
+        nlohmann::json section;
+        section["asset_type"] = gains.mAssetType;
+        section["country"] = gains.mCountry;
+        section["transactions"] = nlohmann::json::array();
+        for (const auto& row : gains.mTransactions) {
+            nlohmann::json transaction;
+            transaction["isin"] = row.mIsin;
+            transaction["transaction_type"] = row.mType;
+            transaction["transaction_date"] = row.mDate;
+            transaction["amount_of_units"] = row.mAmount;
+            transaction["exchange_rate"] = row.mExchangeRate;
+            if (row.mUnitPrice) {
+                transaction["unit_price"] = *row.mUnitPrice;
+            }
+            section["transactions"].push_back(std::move(transaction));
+        }
+        result["gains_and_losses_section"].push_back(std::move(section));
+    }
 
+    result["withholding_tax_section"] = std::move(aState.mWithholding);
+
+    result["transaction_history"] = nlohmann::json::array();
+    for (const auto& history : joinHistoryPages(aState.mHistoryPages)) {
+        nlohmann::json group;
+        group["isin"] = history.mIsin;
+        group["transactions"] = nlohmann::json::array();
+        for (const auto& row : history.mTransactions) {
+            nlohmann::json transaction;
+            transaction["transaction_type"] = row.mType;
+            transaction["transaction_date"] = row.mDate;
+            transaction["value_date"] = row.mValueDate;
+            transaction["currency"] = "EUR";
+            transaction["exchange_rate"] = row.mExchangeRate;
+            transaction["amount_of_units"] = row.mAmount;
+            transaction["market_value"] = row.mMarketValue;
+            group["transactions"].push_back(std::move(transaction));
+        }
+        result["transaction_history"].push_back(std::move(group));
+    }
     return result;
 }
 
-void ReportLoader::clearRawText() {
-    if (mMode == ProcessingMode::InMemory) {
-        mRawText.clear();
-    } else {
-        if (!mTempFilePath.empty()) {
-            std::filesystem::remove(mTempFilePath);
-            mTempFilePath.clear();
+// Mirrors XmlGenerator::parse_json over the JSON toJson would build, without building it
+Transactions ReportLoader::toTransactions(ParseState& aState, const std::set<TransactionType>& aTypes) const {
+    Transactions transactions;
+
+    for (auto& gains : joinGainsPages(aState.mGainsPages)) {
+        if (!aTypes.contains(string_to_asset_type(gains.mAssetType))) {
+            continue;
+        }
+
+        for (const auto& row : gains.mTransactions) {
+            const auto type = string_to_trade_type(row.mType);
+            if (!row.mUnitPrice || !type) {
+                continue; // No EUR line below the row, or not a trade
+            }
+
+            std::string isin;
+            std::string name;
+            parse_isin(row.mIsin, isin, name);
+            transactions.mGains.add(isin, name, parse_day(row.mDate), *type, row.mAmount, *row.mUnitPrice);
         }
     }
+
+    for (const auto& income : aState.mIncome) {
+        if (income.mAssetType == "Equities" || income.mAssetType == "Funds") {
+            for (const auto& row : income.mTransactions) {
+                std::string isin;
+                std::string name;
+                parse_isin(row.mIsin, isin, name);
+                transactions.mIncome.mDivTransactions.add(isin, name, parse_day(row.mValueDate), income.mCountry, row.mGrossIncome,
+                                                          row.mWithholdingTax);
+            }
+        }
+
+        if (income.mAssetType == "Liquidity") {
+            double grossIncome = 0.0;
+            double netIncome = 0.0;
+            for (const auto& row : income.mTransactions) {
+                grossIncome += row.mGrossIncome;
+                netIncome += row.mNetIncome;
+            }
+
+            DhoTransaction interest;
+            interest.mPayer = "Trade Republic";
+            interest.mGrossIncome = grossIncome;
+            interest.mWitholdingTax = grossIncome - netIncome;
+            transactions.mIncome.mInterests[interest.mPayer].push_back(std::move(interest));
+        }
+    }
+
+    return transactions;
 }
 
-void ReportLoader::parseHeader(std::istringstream& aIss, nlohmann::json& aResult) {
-    std::regex headerRegex(R"(^(Client|Period|Currency|Country):\s+(.+)$)");
-    std::smatch match;
+// Sections only share the header, so once the headings are located the report is parsed as independent jobs.
+// Every gains and history page is a job of its own, the pages are joined in order afterwards. Income lines are read across
+// the repeated heading, so all pages of an income or withholding section form one job that parses them in order.
+ReportLoader::ParseState ReportLoader::parseReportBySection(std::string_view aText) const {
+    // Section title and offset of every heading, a repeated heading starts the next page of its section
+    std::vector<std::pair<std::string, size_t>> headings;
+    LineCursor scanner {aText};
+    while (const auto line = scanner.next()) {
+        if (const auto section = mGrammar->match<report_lines::SectionLine>(line->mText)) {
+            headings.emplace_back(section->str(2), static_cast<size_t>(line->mRaw.data() - aText.data()));
+        }
+    }
 
-    while (auto line = extractLine(aIss)) {
-        std::string trimmedLine = trim(*line);
+    ParseState state;
+    LineCursor headerCursor {aText.substr(0, headings.empty() ? aText.size() : headings.front().second)};
+    parseSections(headerCursor, state);
+
+    std::vector<std::vector<std::string_view>> jobs; // Texts a job parses one after the other
+    std::map<std::string, size_t> sectionJobs;       // Income or withholding title -> its job
+    for (size_t i = 0; i < headings.size(); ++i) {
+        const auto& [title, offset] = headings[i];
+        // Summary sections and sections not asked for are skipped by parseSections anyway
+        const auto section = detailedSection(*mGrammar, title);
+        if (!section || !(mRequiredSections.empty() || mRequiredSections.contains(*section))) {
+            continue;
+        }
+
+        const auto pageEnd = i + 1 < headings.size() ? headings[i + 1].second : aText.size();
+        if (section == ReportSection::GainsAndLosses || section == ReportSection::TransactionHistory) {
+            jobs.push_back({aText.substr(offset, pageEnd - offset)});
+            continue;
+        }
+
+        const auto [job, added] = sectionJobs.try_emplace(title, jobs.size());
+        if (added) {
+            jobs.emplace_back();
+        }
+        auto& runs = jobs[job->second];
+        if (i > 0 && headings[i - 1].first == title) {
+            runs.back() = std::string_view {runs.back().data(), static_cast<size_t>(aText.data() + pageEnd - runs.back().data())};
+        } else {
+            runs.push_back(aText.substr(offset, pageEnd - offset));
+        }
+    }
+
+    std::vector<ParseState> results(jobs.size());
+    std::vector<std::exception_ptr> errors(jobs.size());
+    std::atomic<size_t> nextJob {0};
+    auto work = [&] {
+        for (size_t job = nextJob++; job < jobs.size(); job = nextJob++) {
+            try {
+                for (const auto text : jobs[job]) {
+                    LineCursor cursor {text};
+                    parseSections(cursor, results[job]);
+                }
+            } catch (...) {
+                errors[job] = std::current_exception();
+            }
+        }
+    };
+
+    const unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    const auto numWorkers = std::clamp<size_t>(mThreadCount == 0 ? hardwareThreads : mThreadCount, 1, std::max<size_t>(jobs.size(), 1));
+    std::vector<std::thread> workers;
+    workers.reserve(numWorkers - 1);
+    for (size_t w = 1; w < numWorkers; ++w) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Jobs are in document order and a section's pages never share a job with another section
+    for (auto& result : results) {
+        std::ranges::move(result.mIncome, std::back_inserter(state.mIncome));
+        std::ranges::move(result.mGainsPages, std::back_inserter(state.mGainsPages));
+        std::ranges::move(result.mWithholding, std::back_inserter(state.mWithholding));
+        std::ranges::move(result.mHistoryPages, std::back_inserter(state.mHistoryPages));
+    }
+    return state;
+}
+
+void ReportLoader::clearRawText() {
+    mStrippedBytes = 0;
+    mDocument.reset();
+    mPdfData = {};
+    mMappedPdf.reset();
+    mSelection = PageSelection {};
+    mCacheKey.clear();
+
+    // Auto can leave text behind in both places when it spilled over the budget
+    mRawText.release();
+    mTempFile.remove();
+}
+
+void ReportLoader::parseHeader(LineCursor& aCursor, nlohmann::json& aResult) const {
+    while (const auto line = aCursor.next()) {
+        const auto trimmedLine = line->mText;
         if (trimmedLine.empty()) continue;
 
-        if (std::regex_match(trimmedLine, match, headerRegex)) {
-            std::string key = match[1].str();
-            std::string value = match[2].str();
-            if (key == "Client"){
-                aResult["client"] = value;
-                mClientNumber = value;
-            } 
+        if (const auto match = mGrammar->match<report_lines::HeaderLine>(trimmedLine)) {
+            std::string key = match->str(1);
+            std::string value = match->str(2);
+            if (key == "Client") aResult["client"] = value;
             else if (key == "Period") aResult["period"] = value;
             else if (key == "Currency") aResult["currency"] = value;
             else if (key == "Country") aResult["country"] = value;
         } else {
             // Rewind the stream to the beginning of the non-header line
-            aIss.seekg(-static_cast<long>(line->length() + 1), std::ios::cur);
+            aCursor.unread();
             break;
         }
     }
 }
 
-void ReportLoader::parseIncomeSection(std::istringstream& aIss, std::vector<nlohmann::json>& aIncomeSections) {
-    TransactionContext context;
-    std::regex assetTypeRegex(R"(^Asset Type: (.+)$)");
-    std::regex countryRegex(R"(^Country: (.+)$)");
-    std::regex isinRegex(R"(^([A-Z0-9]+ - .+)$)");
-    std::regex interestPaymentRegex(R"(^(Interest payment)\s+(\d{2}\.\d{2}\.\d{4})\s+([\d,.]+)\s+([\d,.]+)\s*$)");
-    std::regex dividendRegex(R"(^(Dividend)\s+(\d{2}\.\d{2}\.\d{4})\s+([\d,.]+)\s+([\d,.]+)\s*$)");
-    std::regex amountRegex(R"(^EUR\s+([\d,.]+)\s+(-?[\d,.]+)?\s*([\d,.]+)?\s*$)");
-    std::regex incomeTotalRegex(R"(^Total for ([A-Za-z\s]+).*$)");
-    std::regex sectionRegex(R"(^([IVX]+\.)\s+(.+)$)");
+void ReportLoader::parseIncomeSection(LineCursor& aCursor, std::vector<IncomeSection>& aIncomeSections, std::string& aLastIsin) const {
+    using namespace report_lines;
+    IncomeSection context;
+    std::string isin;
 
     bool hasTransactions = false;
 
-    while (auto line = extractLine(aIss)) {
-        std::string trimmedLine = trim(*line);
+    while (const auto line = aCursor.next()) {
+        const auto trimmedLine = line->mText;
         if (trimmedLine.empty()) continue;
 
-        std::smatch match;
-        if (std::regex_match(trimmedLine, match, sectionRegex)) {
-            if(match[2].str() != SECTION_INCOME) {
-                // Rewind stream to before this section header
-                aIss.seekg(-static_cast<long>(line->length() + 1), std::ios::cur);
-                break;
-            }
+        const auto match = mGrammar->classify<IncomeLines>(trimmedLine);
+        if (match.is<SectionLine>() && !mGrammar->is(words::SECTION_INCOME, match[2])) {
+            // Rewind stream to before this section header
+            aCursor.unread();
+            break;
         }
 
-        if (std::regex_match(trimmedLine, match, incomeTotalRegex)) {
-            nlohmann::json section;
+        switch (match.mKind) {
+            case IncomeLines::KIND<IncomeTotalLine>: {
+                if (!context.mAssetType.empty() && !context.mCountry.empty()) {
+                    aLastIsin = isin;
+                    aIncomeSections.push_back(context);
+
+                    // Reset context for next country
+                    context.mTransactions.clear();
+                    isin.clear();
+                    context.mCountry.clear();
+                    hasTransactions = false;
+                }
+                continue;
+            }
 
-            if (!context.mAssetType.empty() && !context.mCountry.empty()) {
-                mLastContext.mAssetType = context.mAssetType;
-                mLastContext.mCountry = context.mCountry;
-                mLastContext.mIsin = context.mIsin;
+            case IncomeLines::KIND<AssetTypeLine>:
+                context.mAssetType = match.str(1);
+                continue;
 
-                section["asset_type"] = mLastContext.mAssetType;
-                section["country"] = mLastContext.mCountry;
-                section["transactions"] = context.mTransactions;
-                if (context.mTotals.empty()) {
-                    double grossIncome = 0.0;
-                    double netIncome = 0.0;
-                    for (const auto& txn : context.mTransactions) {
-                        grossIncome += txn["gross_income"].get<double>();
-                        netIncome += txn["net_income"].get<double>();
-                    }
-                    context.mTotals["gross_income"] = grossIncome;
-                    context.mTotals["net_income"] = netIncome;
+            case IncomeLines::KIND<CountryLine>: {
+                std::string country = match.str(1);
+                if (std::count(country.begin(), country.end(), ' ') > 10) {
+                    continue; // skip this line if more than 3 spaces
                 }
-                section["totals"] = context.mTotals;
-                aIncomeSections.push_back(section);
-                
-                // Reset context for next country
-                context.mTransactions.clear();
-                context.mTotals.clear();
-                context.mIsin.clear();
-                context.mCountry.clear();
-                hasTransactions = false;
+
+                context.mCountry = std::move(country);
+                continue;
             }
-            continue;
-        }
 
-        if (std::regex_match(trimmedLine, match, assetTypeRegex)) {
-            context.mAssetType = match[1].str();
-            continue;
-        }
+            case IncomeLines::KIND<IsinLine>:
+                isin = isinText(match);
+                continue;
 
-        if (std::regex_match(trimmedLine, match, countryRegex)) {
-            std::string country = match[1].str();
-            if (std::count(country.begin(), country.end(), ' ') > 10) {
-                continue; // skip this line if more than 3 spaces
-            }
+            case IncomeLines::KIND<IncomePaymentLine>:
+                break;
 
-            context.mCountry = std::move(country);
-            continue;
+            default:
+                continue; // Section header of this section, client number and other lines
         }
 
-        if (std::regex_match(trimmedLine, match, isinRegex)) {
-            context.mIsin = match[1].str();
-            continue;
-        }
+        IncomeRow transaction;
+        const bool deposit = context.mAssetType == "Liquidity";
 
-        if (trimmedLine == mClientNumber) {
-            continue; // Skip lines that match the client number
+        if (!isin.empty()) {
+            aLastIsin = isin;
         }
 
-        if (std::regex_match(trimmedLine, match, interestPaymentRegex) ||
-            std::regex_match(trimmedLine, match, dividendRegex)) {
-            nlohmann::json transaction;
-
-            std::string isin = !context.mIsin.empty() ? context.mIsin : mLastContext.mIsin;
-            mLastContext.mIsin = isin.empty() ? mLastContext.mIsin : isin;
-
-            if (context.mAssetType != "Liquidity") {
-                transaction["isin"] = isin;
-                transaction["DEPOSIT"] = false;
-            }
-            
-            if (context.mAssetType == "Liquidity") {
-                transaction["DEPOSIT"] = true;
-            }
-            
-            transaction["transaction_type"] = match[1].str();
-            transaction["value_date"] = match[2].str();
-            std::string amountStr = match[3].str();
-            std::string exchangeRateStr = match[4].str();
-            transaction["amount_of_units"] = getNonNegativeDouble(parseDouble(amountStr).value_or(0.0));
-            transaction["exchange_rate"] = parseDouble(exchangeRateStr).value_or(0.0);
-
-            transaction["gross_income"] = 0.0;
-            if (context.mAssetType != "Liquidity") {
-                transaction["withholding_tax"] = 0.0;
-            }
-            transaction["net_income"] = 0.0;
-
-            auto currentPos = aIss.tellg();
-            bool foundAmount = false;
-
-            // Check the next line for EUR amounts
-            while (auto nextLine = extractLine(aIss)) {
-                std::string trimmedNext = trim(*nextLine);
-                std::smatch amountMatch;
-                if (std::regex_match(trimmedNext, amountMatch, amountRegex)) {
-                    std::string grossStr = amountMatch[1].str();
-                    transaction["gross_income"] = parseDouble(grossStr).value_or(0.0);
-
-                    if (amountMatch[2].matched) {
-                        std::string taxStr = amountMatch[2].str();
-                        if (context.mAssetType != "Liquidity") {
-                            transaction["withholding_tax"] = getNonNegativeDouble(parseDouble(taxStr).value_or(0.0));
-                        }
-                    } else {
-                        if (context.mAssetType != "Liquidity") {
-                            transaction["withholding_tax"] = 0.0;
-                        }
-                    }
+        transaction.mDeposit = deposit;
+        transaction.mIsin = aLastIsin;
+        transaction.mType = std::string {mGrammar->canonical(match[1])};
+        transaction.mValueDate = match.str(2);
+        transaction.mAmount = getNonNegativeDouble(parseDouble(match[3]).value_or(0.0));
+        transaction.mExchangeRate = parseDouble(match[4]).value_or(0.0);
+
+        // EUR amounts are on the next line, fall back to the line before the payment
+        auto amountMatch = mGrammar->match<IncomeAmountLine>(aCursor.peek().value_or(LineCursor::Line {}).mText);
+        if (!amountMatch) {
+            amountMatch = mGrammar->match<IncomeAmountLine>(aCursor.lookbehind(2).value_or(LineCursor::Line {}).mText);
+        }
 
-                    if (amountMatch[3].matched) {
-                        std::string netStr = amountMatch[3].str();
-                        transaction["net_income"] = parseDouble(netStr).value_or(0.0);
-                    }
-                    else if (amountMatch.size() == 4 && amountMatch[3].str().empty() && match[2].str()[0] != '-') {
-                        std::string netStr = amountMatch[2].str();
-                        transaction["net_income"] = parseDouble(netStr).value_or(0.0);
-                    }
-                    else {
-                        double gross = transaction["gross_income"].get<double>();
-                        if (context.mAssetType != "Liquidity") {
-                            double tax = transaction["withholding_tax"].get<double>();
-                            transaction["net_income"] = gross + tax;
-                        }
-                    }
+        if (amountMatch) {
+            transaction.mGrossIncome = parseDouble((*amountMatch)[1]).value_or(0.0);
 
-                    foundAmount = true;
-                    aIss.seekg(-static_cast<long>(nextLine->length() + 1), std::ios::cur);
-                    break;
-                }
-                aIss.seekg(-static_cast<long>(nextLine->length() + 1), std::ios::cur);
-                break; // Avoid infinite loop, only check the immediate next line
-            }
-
-            // Fallback to previous line only if next line didn't match
-            if (!foundAmount && currentPos > 0) {
-                aIss.seekg(-static_cast<long>(line->length() + 1), std::ios::cur);
-                while (auto prevLine = extractLine(aIss)) {
-                    std::string trimmedPrev = trim(*prevLine);
-                    std::smatch amountMatch;
-                    if (std::regex_match(trimmedPrev, amountMatch, amountRegex)) {
-                        std::string grossStr = amountMatch[1].str();
-                        transaction["gross_income"] = parseDouble(grossStr).value_or(0.0);
-
-                        if (amountMatch[2].matched) {
-                            std::string taxStr = amountMatch[2].str();
-                            if (context.mAssetType != "Liquidity") {
-                                double withholding_tax = parseDouble(taxStr).value_or(0.0);
-                                transaction["withholding_tax"] = withholding_tax;
-                            }
-                        } else {
-                            if (context.mAssetType != "Liquidity") {
-                                transaction["withholding_tax"] = 0.0;
-                            }
-                        }
-
-                        if (amountMatch[3].matched) {
-                            std::string netStr = amountMatch[3].str();
-                            transaction["net_income"] = parseDouble(netStr).value_or(0.0);
-                        }
-                        else if (amountMatch.size() == 4 && amountMatch[3].str().empty() && match[2].str()[0] != '-') {
-                            std::string netStr = amountMatch[2].str();
-                            transaction["net_income"] = parseDouble(netStr).value_or(0.0);
-                        }
-                        else {
-                            double gross = transaction["gross_income"].get<double>();
-                            if (context.mAssetType != "Liquidity") {
-                                double tax = transaction["withholding_tax"].get<double>();
-                                transaction["net_income"] = gross + tax;
-                            }
-                        }
-
-                        foundAmount = true;
-                        aIss.seekg(-static_cast<long>(prevLine->length() + 1), std::ios::cur);
-                        break;
-                    }
-                    aIss.seekg(-static_cast<long>(prevLine->length() + 1), std::ios::cur);
-                    break; // Avoid infinite loop
-                }
-                aIss.seekg(currentPos, std::ios::beg);
+            if (amountMatch->matched(2) && !deposit) {
+                transaction.mWithholdingTax = getNonNegativeDouble(parseDouble((*amountMatch)[2]).value_or(0.0));
             }
 
-            context.mTransactions.push_back(transaction);
-            hasTransactions = true;
+            if (amountMatch->matched(3)) {
+                transaction.mNetIncome = parseDouble((*amountMatch)[3]).value_or(0.0);
+            }
+            else if (amountMatch->str(3).empty() && match.str(2)[0] != '-') {
+                transaction.mNetIncome = parseDouble((*amountMatch)[2]).value_or(0.0);
+            }
+            else if (!deposit) {
+                transaction.mNetIncome = transaction.mGrossIncome + transaction.mWithholdingTax;
+            }
         }
+
+        context.mTransactions.push_back(std::move(transaction));
+        hasTransactions = true;
     }
 }
 
-void ReportLoader::parseGainsAndLossesSection(std::istringstream& aIss, std::vector<nlohmann::json>& aGainsSections) {
-    TransactionContext context;
-    std::regex assetTypeRegex(R"(^Asset Type: (.+)$)");
-    std::regex countryRegex(R"(^Country: (.+)$)");
-    std::regex isinRegex(R"(^([A-Z0-9]+ - .+)$)");
-    std::regex gainsTransactionRegex(R"(^(Trading Buy|Trading Sell)\s+(\d{2}\.\d{2}\.\d{4})\s+(-?\d{1,3}(?:,\d{3})*(?:\.\d+)?)\s+(-?\d{1,3}(?:,\d{3})*(?:\.\d+)?)\s*$)");
-    std::regex gainsAmountRegex(R"(^EUR\s+(-?\d{1,3}(?:,\d{3})*(?:\.\d+)?)\s+(-?\d{1,3}(?:,\d{3})*(?:\.\d+)?)\s+(-?\d{1,3}(?:,\d{3})*(?:\.\d+)?)\s+(-?\d{1,3}(?:,\d{3})*(?:\.\d+)?)\s+(-?\d{1,3}(?:,\d{3})*(?:\.\d+)?)\s+(-?\d{1,3}(?:,\d{3})*(?:\.\d+)?)$)");
-    std::regex gainsTotalRegex(R"(^(Gains|Losses)\s+EUR\s+(-?\d{1,3}(?:,\d{3})*(?:\.\d+)?)\s+(-?\d{1,3}(?:,\d{3})*(?:\.\d+)?)\s+(-?\d{1,3}(?:,\d{3})*(?:\.\d+)?)$)");
-    std::regex sectionRegex(R"(^([IVX]+\.)\s+(.+)$)");
-    std::regex reportIDRegex(R"(^Report ID:\s+(.+)$)");
-
-    bool inTransactionBlock = false;
-
-    while (auto line = extractLine(aIss)) {
-        std::string trimmedLine = trim(*line);
+void ReportLoader::parseGainsAndLossesSection(LineCursor& aCursor, std::vector<SectionPage>& aPages) const {
+    using namespace report_lines;
+    using EntryKind = SectionPage::EntryKind;
+    SectionPage page;
+
+    while (const auto line = aCursor.next()) {
+        // Page break, also when the "Report ID" footer was stripped
+        if (line->mRaw.find('\f') != std::string_view::npos) {
+            page.mEntries.push_back({EntryKind::PageEnd});
+        }
+
+        const auto trimmedLine = line->mText;
         if (trimmedLine.empty()) continue;
 
-        std::smatch match;
-        if (std::regex_match(trimmedLine, match, sectionRegex)) {
-            aIss.seekg(-static_cast<long>(line->length() + 1), std::ios::cur);
+        const auto match = mGrammar->classify<GainsLines>(trimmedLine);
+        if (match.is<SectionLine>()) {
+            aCursor.unread();
             break;
         }
 
-        if (std::regex_match(trimmedLine, match, assetTypeRegex)) {
-            context.mAssetType = match[1].str();
-            continue;
-        }
+        switch (match.mKind) {
+            case GainsLines::KIND<AssetTypeLine>:
+                page.mEntries.push_back({EntryKind::AssetType, match.str(1)});
+                continue;
 
-        if (std::regex_match(trimmedLine, match, countryRegex)) {
-            context.mCountry = match[1].str();
-            continue;
+            case GainsLines::KIND<CountryLine>:
+                page.mEntries.push_back({EntryKind::Country, match.str(1)});
+                continue;
+
+            case GainsLines::KIND<IsinLine>:
+                page.mEntries.push_back({EntryKind::Isin, isinText(match)});
+                continue;
+
+            case GainsLines::KIND<GainsTotalLine>:
+                page.mEntries.push_back({EntryKind::Total});
+                continue;
+
+            case GainsLines::KIND<ReportIdLine>:
+                page.mEntries.push_back({EntryKind::PageEnd});
+                continue;
+
+            default:
+                break;
         }
 
-        if (std::regex_match(trimmedLine, match, isinRegex)) {
-            context.mIsin = match[1].str();
-            inTransactionBlock = true;
+        const auto gainsRow = matchGainsRow(*mGrammar, trimmedLine, match);
+        if (!gainsRow) {
             continue;
         }
 
-        if (std::regex_match(trimmedLine, match, gainsTotalRegex) && !context.mIsin.empty()) {
-            std::string type = match[1].str();
+        TradeRow transaction;
+        transaction.mType = gainsRow->mType;
+        transaction.mDate = gainsRow->mDate;
 
-            nlohmann::json section;
-            section["asset_type"] = context.mAssetType;
-            section["country"] = context.mCountry;
-            section["transactions"] = context.mTransactions;
-            // section["totals"] = context.mTotals;
-            aGainsSections.push_back(section);
-            context = TransactionContext();
-            inTransactionBlock = false;
-            continue;
-        }
+        auto amount = parseDouble(gainsRow->mAmount);
+        auto rate   = parseDouble(gainsRow->mExchangeRate);
+
+        transaction.mAmount       = getNonNegativeDouble(amount.value_or(0.0));
+        transaction.mExchangeRate = rate.value_or(0.0);
 
-        if (std::regex_match(trimmedLine, match, gainsTransactionRegex) && !inTransactionBlock) {
-            inTransactionBlock = true;
-            context = mLastContext;
+        // Look for the EUR line with additional details
+        if (const auto nextLine = aCursor.next()) {
+            const auto trimmedNext = nextLine->mText;
+            const auto cells = splitCells(trimmedNext);
+            if (cells.size() > 1 && cells[0] == "EUR" && isLooseNumber(cells[1], true)) {
+                transaction.mUnitPrice = parseDouble(cells[1]).value_or(0.0);
+            }
+            else if (const auto amounts = mGrammar->match<GainsAmountLine>(trimmedNext)) {
+                transaction.mUnitPrice = parseDouble((*amounts)[1]).value_or(0.0);
+            } else {
+                std::vector<std::string> tokens {ReportLoader::normalizeSpaces(trimmedNext)};
+                transaction.mUnitPrice = parseDouble(tokens[0]).value_or(0.0);
+            }
         }
 
-        if (inTransactionBlock) {
-            if (std::regex_match(trimmedLine, match, gainsTransactionRegex)) {
-                nlohmann::json transaction;
-                transaction["isin"] = context.mIsin;
-                transaction["transaction_type"] = match[1].str();
-                transaction["transaction_date"] = match[2].str();
-
-                auto amount = match.size() > 3 ? parseDouble(match[3].str()) : std::nullopt;
-                auto rate   = match.size() > 4 ? parseDouble(match[4].str()) : std::nullopt;
-
-                transaction["amount_of_units"] = getNonNegativeDouble(amount.value_or(0.0));
-                transaction["exchange_rate"]   = rate.value_or(0.0);
-
-                // Look for the EUR line with additional details
-                if (auto nextLine = extractLine(aIss)) {
-                    std::string trimmedNext = trim(*nextLine);
-                    if (std::regex_match(trimmedNext, match, gainsAmountRegex)) {
-                        transaction["unit_price"] = parseDouble(match[1].str()).value_or(0.0);
-                    } else {
-                        std::vector<std::string> amounts {ReportLoader::normalizeSpaces(trimmedNext)};
-                        transaction["unit_price"] = parseDouble(amounts[0]).value_or(0.0);
+        page.mEntries.push_back({EntryKind::Row, {}, std::move(transaction)});
+    }
+
+    aPages.push_back(std::move(page));
+}
+
+std::vector<ReportLoader::GainsSection> ReportLoader::joinGainsPages(std::vector<SectionPage>& aPages) const {
+    using EntryKind = SectionPage::EntryKind;
+    std::vector<GainsSection> gainsSections;
+
+    struct Block {
+        GainsSection mSection {};
+        std::string mIsin {};
+    };
+    Block carry; // Block open at the last page break
+
+    for (auto& page : aPages) {
+        Block context;
+        bool inTransactionBlock = false;
+
+        for (auto& entry : page.mEntries) {
+            switch (entry.mKind) {
+                case EntryKind::PageEnd:
+                    if (inTransactionBlock) {
+                        carry = context;
                     }
-                }
+                    break;
 
-                context.mTransactions.push_back(transaction);
-            } 
-            else if (std::regex_match(trimmedLine, match, reportIDRegex) && inTransactionBlock){
-                mLastContext = context;
+                case EntryKind::AssetType:
+                    context.mSection.mAssetType = std::move(entry.mValue);
+                    break;
+
+                case EntryKind::Country:
+                    context.mSection.mCountry = std::move(entry.mValue);
+                    break;
+
+                case EntryKind::Isin:
+                    context.mIsin = std::move(entry.mValue);
+                    inTransactionBlock = true;
+                    break;
+
+                case EntryKind::Total:
+                    if (context.mIsin.empty()) {
+                        break;
+                    }
+
+                    gainsSections.push_back(std::move(context.mSection));
+                    context = Block();
+                    inTransactionBlock = false;
+                    break;
+
+                case EntryKind::Row:
+                    // Rows before any ISIN on this page continue the block from the page before
+                    if (!inTransactionBlock) {
+                        inTransactionBlock = true;
+                        context = carry;
+                    }
+                    entry.mRow.mIsin = context.mIsin;
+                    context.mSection.mTransactions.push_back(std::move(entry.mRow));
+                    break;
             }
-            continue;
         }
     }
+
+    return gainsSections;
 }
 
-void ReportLoader::parseWithholdingTaxSection(std::istringstream& aIss, std::vector<nlohmann::json>& aWithholdingSections) {
+void ReportLoader::parseWithholdingTaxSection(LineCursor& aCursor, std::vector<nlohmann::json>& aWithholdingSections) const {
+    using namespace report_lines;
     TransactionContext context;
-    std::regex countryRegex(R"(^([A-Za-z\s]+)$)");
-    std::regex isinRegex(R"(^([A-Z0-9]+ - .+)$)");
-    std::regex withholdingTaxRegex(R"(^(Dividend)\s+(\d{2}\.\d{2}\.\d{4})\s+([\d\.]+)\s*$)");
-    std::regex withholdingAmountRegex(R"(^EUR\s+([\d\.]+)\s+([\d\.]+)\s+([\d\.]+%)\s+([\d\.]+)\s*$)");
-    std::regex withholdingTotalRegex(R"(^(Total for|Overall Total In EUR)\s+([\d\.]+)\s+([\d\.]+)$)");
-    std::regex sectionRegex(R"(^([IVX]+\.)\s+(.+)$)");
-
-    while (auto line = extractLine(aIss)) {
-        std::string trimmedLine = trim(*line);
+
+    while (const auto line = aCursor.next()) {
+        const auto trimmedLine = line->mText;
         if (trimmedLine.empty()) continue;
 
-        std::smatch match;
-        if (std::regex_match(trimmedLine, match, sectionRegex)) {
-            aIss.seekg(-static_cast<long>(line->length() + 1), std::ios::cur);
+        const auto match = mGrammar->classify<WithholdingLines>(trimmedLine);
+        if (match.is<SectionLine>()) {
+            aCursor.unread();
             break;
         }
 
-        if (std::regex_match(trimmedLine, match, countryRegex) && !trimmedLine.starts_with("Total")) {
-            context.mCountry = match[1].str();
-            continue;
-        }
+        switch (match.mKind) {
+            case WithholdingLines::KIND<WithholdingCountryLine>:
+                if (!trimmedLine.starts_with("Total")) {
+                    context.mCountry = match.str(1);
+                }
+                continue;
 
-        if (std::regex_match(trimmedLine, match, isinRegex)) {
-            context.mIsin = match[1].str();
-            continue;
-        }
+            case WithholdingLines::KIND<IsinLine>:
+                context.mIsin = isinText(match);
+                continue;
 
-        if (std::regex_match(trimmedLine, match, withholdingTaxRegex)) {
+            case WithholdingLines::KIND<WithholdingDividendLine>: {
                 nlohmann::json transaction;
                 transaction["isin"] = context.mIsin;
-                transaction["transaction_type"] = match[1].str();
-            transaction["payment_date"] = match[2].str();
-            transaction["exchange_rate"] = parseDouble(match[3].str()).value_or(0.0);
-
-                if (auto nextLine = extractLine(aIss)) {
-                    std::string trimmedNext = trim(*nextLine);
-                if (std::regex_match(trimmedNext, match, withholdingAmountRegex)) {
-                    transaction["income_in_eur"] = parseDouble(match[1].str()).value_or(0.0);
-                    transaction["withholding_tax_amount_in_eur"] = parseDouble(match[2].str()).value_or(0.0);
-                    transaction["withholding_tax_rate"] = match[3].str();
-                    transaction["dtt_amount_in_eur"] = parseDouble(match[4].str()).value_or(0.0);
+                transaction["transaction_type"] = std::string {mGrammar->canonical(match[1])};
+                transaction["payment_date"] = match.str(2);
+                transaction["exchange_rate"] = parseDouble(match[3]).value_or(0.0);
+
+                if (const auto nextLine = aCursor.next()) {
+                    const auto trimmedNext = nextLine->mText;
+                    if (const auto amounts = mGrammar->match<WithholdingAmountLine>(trimmedNext)) {
+                        transaction["income_in_eur"] = parseDouble((*amounts)[1]).value_or(0.0);
+                        transaction["withholding_tax_amount_in_eur"] = parseDouble((*amounts)[2]).value_or(0.0);
+                        transaction["withholding_tax_rate"] = amounts->str(3);
+                        transaction["dtt_amount_in_eur"] = parseDouble((*amounts)[4]).value_or(0.0);
+                    }
                 }
-            }
 
-            if (auto nextLine = extractLine(aIss)) {
-                std::string trimmedNext = trim(*nextLine);
-                if (std::regex_match(trimmedNext, match, withholdingAmountRegex)) {
-                    transaction["income_in_eur"] = parseDouble(match[1].str()).value_or(0.0);
-                    transaction["withholding_tax_amount_in_eur"] = parseDouble(match[2].str()).value_or(0.0);
-                    transaction["dtt_rate"] = match[3].str();
-                    transaction["dtt_amount_in_eur"] = parseDouble(match[4].str()).value_or(0.0);
+                if (const auto nextLine = aCursor.next()) {
+                    const auto trimmedNext = nextLine->mText;
+                    if (const auto amounts = mGrammar->match<WithholdingAmountLine>(trimmedNext)) {
+                        transaction["income_in_eur"] = parseDouble((*amounts)[1]).value_or(0.0);
+                        transaction["withholding_tax_amount_in_eur"] = parseDouble((*amounts)[2]).value_or(0.0);
+                        transaction["dtt_rate"] = amounts->str(3);
+                        transaction["dtt_amount_in_eur"] = parseDouble((*amounts)[4]).value_or(0.0);
                     }
                 }
                 context.mTransactions.push_back(transaction);
-        } else if (std::regex_match(trimmedLine, match, withholdingTotalRegex)) {
-            std::string totalType = match[1].str();
-            (void)totalType;
-            nlohmann::json totals;
-            totals["withholding_tax_amount_in_eur"] = parseDouble(match[2].str()).value_or(0.0);
-            totals["dtt_amount_in_eur"] = parseDouble(match[3].str()).value_or(0.0);
-            context.mTotals = totals;
-            nlohmann::json section;
-            section["country"] = context.mCountry;
-            section["transactions"] = context.mTransactions;
-            section["totals"] = context.mTotals;
-            aWithholdingSections.push_back(section);
-            context = TransactionContext();
+                continue;
+            }
+
+            case WithholdingLines::KIND<WithholdingTotalLine>: {
+                nlohmann::json totals;
+                totals["withholding_tax_amount_in_eur"] = parseDouble(match[2]).value_or(0.0);
+                totals["dtt_amount_in_eur"] = parseDouble(match[3]).value_or(0.0);
+                context.mTotals = totals;
+                nlohmann::json section;
+                section["country"] = context.mCountry;
+                section["transactions"] = context.mTransactions;
+                section["totals"] = context.mTotals;
+                aWithholdingSections.push_back(section);
+                context = TransactionContext();
+                continue;
+            }
+
+            default:
+                continue;
         }
     }
 }
 
-void ReportLoader::parseTransactionHistorySection(std::istringstream& aIss, std::vector<nlohmann::json>& aTransactionHistory) {
-    TransactionContext context;
-    std::regex isinRegex(R"(^([A-Z0-9]+ - .+)$)");
-    std::regex transactionHistoryRegex(
-    R"(^(Trading Buy|Trading Sell)\s+(\d{2}\.\d{2}\.\d{4})\s+(\d{2}\.\d{2}\.\d{4})\s+EUR\s+([\d\.,]+)\s+(-?[\d\.,]+)\s+([\d\.,]+)\s+([\d\.,]+)$)");
-    std::regex sectionRegex(R"(^([IVX]+\.)\s+(.+)$)");
+void ReportLoader::parseTransactionHistorySection(LineCursor& aCursor, std::vector<SectionPage>& aPages) const {
+    using namespace report_lines;
+    using EntryKind = SectionPage::EntryKind;
+    SectionPage page;
 
-    while (auto line = extractLine(aIss)) {
-        std::string trimmedLine = trim(*line);
+    while (const auto line = aCursor.next()) {
+        const auto trimmedLine = line->mText;
         if (trimmedLine.empty()) continue;
 
-        std::smatch match;
-        if (std::regex_match(trimmedLine, match, sectionRegex)) {
-            aIss.seekg(-static_cast<long>(line->length() + 1), std::ios::cur);
+        const auto match = mGrammar->classify<HistoryLines>(trimmedLine);
+        if (match.is<SectionLine>()) {
+            aCursor.unread();
             break;
         }
 
-        if (std::regex_match(trimmedLine, match, isinRegex)) {
-            if (!context.mTransactions.empty() && !context.mIsin.empty()) {
-                nlohmann::json group;
-                group["isin"] = context.mIsin;
-                group["transactions"] = context.mTransactions;
-                aTransactionHistory.push_back(group);
-                context.mTransactions.clear();
-            }
-            context.mIsin = match[1].str();
+        if (match.is<IsinLine>()) {
+            page.mEntries.push_back({EntryKind::Isin, isinText(match)});
             continue;
         }
-        
-        if (std::regex_match(trimmedLine, match, transactionHistoryRegex)) {
-            nlohmann::json transaction;
-            transaction["transaction_type"] = match[1].str();
-            transaction["transaction_date"] = match[2].str();
-            transaction["value_date"] = match[3].str();
-            transaction["currency"] = "EUR";
-            transaction["exchange_rate"] = parseDouble(match[4].str()).value_or(0.0);
-            transaction["amount_of_units"] = getNonNegativeDouble(parseDouble(match[5].str()).value_or(0.0));
-            transaction["market_value"] = parseDouble(match[6].str()).value_or(0.0);
-
-            // If we have next page, before we finish all transactions, we need to check if ISIN is empty and get last ISIN
-            if (context.mIsin.empty() && !mLastContext.mIsin.empty()) {
-                for (auto it = aTransactionHistory.rbegin(); it != aTransactionHistory.rend(); ++it) {
-                    if ((*it)["isin"] == mLastContext.mIsin) {
-                        (*it)["transactions"].push_back(transaction);
-                        break;
-                    }
-                }
-            continue; // skip creating a new group
-            }
-            else {
-                context.mTransactions.push_back(transaction);
-            }
-        }
-    }
-
-    if (!context.mTransactions.empty()) {
-        nlohmann::json group;
-        group["isin"] = context.mIsin;
-        group["transactions"] = context.mTransactions;
-        aTransactionHistory.push_back(group);
 
-        // Remeber last valid ISIN and transactions for next page processing
-        if (!context.mIsin.empty()) {
-            mLastContext.mIsin = context.mIsin;
+        if (const auto row = matchHistoryRow(*mGrammar, trimmedLine, match)) {
+            TradeRow transaction;
+            transaction.mType = row->mType;
+            transaction.mDate = row->mTransactionDate;
+            transaction.mValueDate = row->mValueDate;
+            transaction.mExchangeRate = parseDouble(row->mExchangeRate).value_or(0.0);
+            transaction.mAmount = getNonNegativeDouble(parseDouble(row->mAmount).value_or(0.0));
+            transaction.mMarketValue = parseDouble(row->mMarketValue).value_or(0.0);
+            page.mEntries.push_back({EntryKind::Row, {}, std::move(transaction)});
         }
     }
-}
 
-std::string ReportLoader::trim(std::string_view aLine) const {
-    auto trimmed = aLine | std::ranges::views::drop_while([](char c) { return std::isspace(c); })
-                        | std::ranges::views::reverse
-                        | std::ranges::views::drop_while([](char c) { return std::isspace(c); })
-                        | std::ranges::views::reverse;
-    return std::string(trimmed.begin(), trimmed.end());
+    aPages.push_back(std::move(page));
 }
 
-std::optional<std::string> ReportLoader::extractLine(std::istringstream& aIss) const {
-    std::string line;
-    if (std::getline(aIss, line)) {
-        if (line.starts_with("1: ")) {
-            line = line.substr(3);
-        }
-        return line;
-    }
-    return std::nullopt;
-}
+std::vector<ReportLoader::HistoryGroup> ReportLoader::joinHistoryPages(std::vector<SectionPage>& aPages) const {
+    using EntryKind = SectionPage::EntryKind;
+    std::vector<HistoryGroup> transactionHistory;
+    std::string lastIsin; // ISIN of the last group a page ended with
 
-std::optional<double> ReportLoader::parseDouble(const std::string& mValue) const {
-    std::string s = mValue;
+    for (auto& page : aPages) {
+        HistoryGroup context;
 
-    // Remove thousands separators (comma)
-    s.erase(std::remove(s.begin(), s.end(), ','), s.end());
+        for (auto& entry : page.mEntries) {
+            if (entry.mKind == EntryKind::Isin) {
+                if (!context.mTransactions.empty() && !context.mIsin.empty()) {
+                    transactionHistory.push_back(std::move(context));
+                    context.mTransactions.clear();
+                }
+                context.mIsin = std::move(entry.mValue);
+                continue;
+            }
 
-    // Remove spaces
-    s.erase(std::remove_if(s.begin(), s.end(), ::isspace), s.end());
+            // Rows before any ISIN on this page belong to the group the page before ended with
+            if (context.mIsin.empty() && !lastIsin.empty()) {
+                for (auto it = transactionHistory.rbegin(); it != transactionHistory.rend(); ++it) {
+                    if (it->mIsin == lastIsin) {
+                        it->mTransactions.push_back(std::move(entry.mRow));
+                        break;
+                    }
+                }
+                continue;
+            }
+            context.mTransactions.push_back(std::move(entry.mRow));
+        }
 
-    try {
-        size_t pos;
-        double result = std::stod(s, &pos);
-        if (pos == s.length()) {
-            return result;
+        if (!context.mTransactions.empty()) {
+            // Remember the last valid ISIN for the next page
+            if (!context.mIsin.empty()) {
+                lastIsin = context.mIsin;
+            }
+            transactionHistory.push_back(std::move(context));
         }
-    } catch (...) {
-        // Ignore parsing errors for now
+    }
+
+    return transactionHistory;
+}
+
+std::optional<double> ReportLoader::parseDouble(std::string_view aValue) const {
+    double result {0.0};
+    if (numbers::parseDouble(aValue, result) == numbers::ParseStatus::Ok) {
+        return result;
     }
     return std::nullopt;
 }
@@ -704,7 +1574,7 @@ std::vector<std::string> ReportLoader::tokenize(std::string_view aLine) const {
 }
 
 // Replace common "weird" whitespace and split into array of number strings
-std::vector<std::string> ReportLoader::normalizeSpaces(const std::string &aLine) const {
+std::vector<std::string> ReportLoader::normalizeSpaces(std::string_view aLine) const {
     std::vector<std::string> tokens;
     std::string current;
     for (unsigned char c : aLine) {
@@ -726,27 +1596,32 @@ std::vector<std::string> ReportLoader::normalizeSpaces(const std::string &aLine)
 #ifdef UNIT_TEST
 bool ReportLoader::saveRawDataToFile(const std::string& aOutputPath) const {
     try {
+        if (mMode == ProcessingMode::Streaming) {
+            std::cerr << "Raw text is not retained in Streaming mode" << std::endl;
+            return false;
+        }
+
         std::ofstream outputFile(aOutputPath, std::ios::binary);
         if (!outputFile) {
             std::cerr << "Failed to create output file: " << aOutputPath << std::endl;
             return false;
         }
 
-        if (mMode == ProcessingMode::InMemory) {
+        if (mMode != ProcessingMode::FileBased) {
             if (mRawText.empty()) {
                 std::cerr << "No raw text available to save" << std::endl;
                 return false;
             }
-            outputFile << mRawText;
+            outputFile << mRawText.view();
         } else {
-            if (mTempFilePath.empty()) {
+            if (mTempFile.empty()) {
                 std::cerr << "No temporary file available to save" << std::endl;
                 return false;
             }
 
-            std::ifstream tempFile(mTempFilePath, std::ios::binary);
+            std::ifstream tempFile(mTempFile.path(), std::ios::binary);
             if (!tempFile) {
-                std::cerr << "Failed to open temporary file: " << mTempFilePath << std::endl;
+                std::cerr << "Failed to open temporary file: " << mTempFile.path() << std::endl;
                 return false;
             }
 
@@ -761,11 +1636,65 @@ bool ReportLoader::saveRawDataToFile(const std::string& aOutputPath) const {
     }
 }
 
-void ReportLoader::setRawText(const std::string& aText) {
-    mRawText = aText;
+void ReportLoader::setRawText(const std::string& aText, ProcessingMode aMode) {
+    mTempFile.remove();
+    mRawText.release();
+    if (aMode == ProcessingMode::FileBased) {
+        auto tempFile = createTempFile();
+        tempFile << aText;
+        tempFile.close();
+        if (!tempFile) {
+            throw std::runtime_error {"Failed to write temporary file: " + mTempFile.path().string()};
+        }
+    } else {
+        mRawText.assign(aText);
+    }
+    mMode = aMode;
+}
+
+void ReportLoader::setRawPages(const std::vector<std::string>& aPages, ProcessingMode aMode, size_t aResidentInput) {
+    clearRawText();
+    for (size_t page = 0; page < aPages.size(); ++page) {
+        mSelection.mPrefetched.emplace(static_cast<int>(page), aPages[page]);
+    }
+
+    // Every page is prefetched, so the document is never asked for
+    const DocumentAccess noDocument = []() -> const poppler::document& { throw std::logic_error {"Raw pages have no document"}; };
+    selectPages(static_cast<int>(aPages.size()), noDocument);
+    detectBoilerplate(noDocument);
+
+    const bool spillOverBudget = aMode == ProcessingMode::Auto;
+    mMode = spillOverBudget ? autoMode(aResidentInput) : aMode;
+    if (mMode == ProcessingMode::InMemory) {
+        extractInMemory(noDocument, spillOverBudget, aResidentInput);
+    } else if (mMode == ProcessingMode::FileBased) {
+        extractToFile(noDocument);
+    } else if (mMode != ProcessingMode::Streaming) {
+        throw std::logic_error {"Raw pages are loaded InMemory, FileBased, Streaming or Auto"};
+    }
+}
+
+void ReportLoader::consumeStream(const std::function<void(LineCursor&)>& aConsume) {
+    streamSelection(aConsume);
+}
+
+const std::vector<int>& ReportLoader::selectedPages() const {
+    return mSelection.mPages;
+}
+
+bool ReportLoader::hasRawText() const {
+    return !mRawText.empty() || !mTempFile.empty();
+}
+
+const std::filesystem::path& ReportLoader::tempFilePath() const {
+    return mTempFile.path();
+}
+
+std::string_view ReportLoader::getRawText() const {
+    return mRawText.view();
 }
 
-const std::string& ReportLoader::getRawText() const {
+const RawTextArena& ReportLoader::getRawTextArena() const {
     return mRawText;
 }
 #endif
\ No newline at end of file
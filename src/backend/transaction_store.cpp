@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <tuple>
+#include <stdexcept>
+
+#include "transaction_store.hpp"
+
+StringPool::Id StringPool::intern(std::string_view aText) {
+    if (const auto found = mIds.find(aText); found != mIds.end()) {
+        return found->second;
+    }
+    const auto id = static_cast<Id>(mStrings.size());
+    mIds.emplace(aText, id);
+    mStrings.emplace_back(aText);
+    return id;
+}
+
+std::optional<StringPool::Id> StringPool::find(std::string_view aText) const {
+    const auto found = mIds.find(aText);
+    return found != mIds.end() ? std::optional {found->second} : std::nullopt;
+}
+
+std::vector<StringPool::Id> StringPool::sort() {
+    std::vector<Id> newIds(mStrings.size());
+    Id next {0};
+    for (auto& [text, id] : mIds) {
+        mStrings[next] = text;
+        newIds[id] = next;
+        id = next++;
+    }
+    return newIds;
+}
+
+size_t SecurityRows::addRow(std::string_view aIsin, std::string_view aName, std::int32_t aDay) {
+    if (mDays.size() >= std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error {"Too many transactions"};
+    }
+
+    const auto security = mIsins.intern(aIsin);
+    if (security == mNames.size()) {
+        mNames.emplace_back(aName); // The first row names the security
+    }
+    mSecurities.push_back(security);
+    mDays.push_back(aDay);
+    mSorted = false;
+    return mDays.size() - 1;
+}
+
+std::vector<std::uint32_t> SecurityRows::sortRows() {
+    // Number the securities in ISIN order, so the row groups follow the same order
+    const auto newIds = mIsins.sort();
+    std::vector<std::string> names(mNames.size());
+    for (size_t security = 0; security < mNames.size(); ++security) {
+        names[newIds[security]] = std::move(mNames[security]);
+    }
+    mNames = std::move(names);
+    for (auto& security : mSecurities) {
+        security = newIds[security];
+    }
+
+    std::vector<std::uint32_t> order(mDays.size());
+    std::iota(order.begin(), order.end(), std::uint32_t {0});
+    std::stable_sort(order.begin(), order.end(), [this](std::uint32_t aLeft, std::uint32_t aRight) {
+        return std::tie(mSecurities[aLeft], mDays[aLeft]) < std::tie(mSecurities[aRight], mDays[aRight]);
+    });
+    permute(mSecurities, order);
+    permute(mDays, order);
+
+    mOffsets.assign(securityCount() + 1, 0);
+    for (const auto security : mSecurities) {
+        ++mOffsets[security + 1];
+    }
+    std::partial_sum(mOffsets.begin(), mOffsets.end(), mOffsets.begin());
+    mSorted = true;
+    return order;
+}
+
+void SecurityRows::requireSorted() const {
+    if (!mSorted) {
+        throw std::logic_error {"Transaction rows are read by security before they were sorted"};
+    }
+}
+
+void GainTransactions::add(std::string_view aIsin, std::string_view aName, std::int32_t aDay, TradeType aType, double aQuantity,
+                           double aUnitPrice) {
+    addRow(aIsin, aName, aDay);
+    mTypes.push_back(aType);
+    mQuantities.push_back(aQuantity);
+    mUnitPrices.push_back(aUnitPrice);
+}
+
+void GainTransactions::sort() {
+    if (sorted()) {
+        return;
+    }
+    const auto order = sortRows();
+    permute(mTypes, order);
+    permute(mQuantities, order);
+    permute(mUnitPrices, order);
+}
+
+void DividendTransactions::add(std::string_view aIsin, std::string_view aName, std::int32_t aDay, std::string_view aCountry,
+                               double aGrossIncome, double aWithholdingTax) {
+    addRow(aIsin, aName, aDay);
+    mCountries.push_back(mCountryNames.intern(aCountry));
+    mGrossIncomes.push_back(aGrossIncome);
+    mWithholdingTaxes.push_back(aWithholdingTax);
+}
+
+void DividendTransactions::sort() {
+    if (sorted()) {
+        return;
+    }
+    const auto order = sortRows();
+    permute(mCountries, order);
+    permute(mGrossIncomes, order);
+    permute(mWithholdingTaxes, order);
+}
@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <iostream>
+#include <thread>
 
 #include "config.hpp"
 #include "util_xml.hpp"
@@ -9,6 +13,15 @@ namespace {
     constexpr auto NS_DOH_DIV = "http://edavki.durs.si/Documents/Schemas/Doh_Div_3.xsd";
     constexpr auto NS_DOH_DHO = "http://edavki.durs.si/Documents/Schemas/Doh_DHO_4.xsd";
     constexpr auto NS_EDP = "http://edavki.durs.si/Documents/Schemas/EDP-Common-1.xsd";
+
+    constexpr size_t KDVP_PARALLEL_MIN_SECURITIES = 64; // Fewer securities are prepared faster than threads start
+    constexpr std::int32_t REPURCHASE_WINDOW_DAYS = 30;  // 97. člen ZDoh-2, purchases this close to a sale hold back its loss
+
+    // Whether any of the sorted purchase days lies less than the window before or after aSaleDay
+    bool bought_near(const std::vector<std::int32_t>& aBuyDays, std::int32_t aSaleDay) {
+        const auto first_after_window_start = std::upper_bound(aBuyDays.begin(), aBuyDays.end(), aSaleDay - REPURCHASE_WINDOW_DAYS);
+        return first_after_window_start != aBuyDays.end() && *first_after_window_start < aSaleDay + REPURCHASE_WINDOW_DAYS;
+    }
 }
 
 std::string XmlGenerator::gain_type_to_string(GainType t) {
@@ -42,7 +55,7 @@ pugi::xml_node XmlGenerator::generate_doh_div(pugi::xml_node parent, const DohDi
     for (const auto& item : data.mItems) {
         auto dividend = parent.append_child("Dividend");
 
-        dividend.append_child("Date").text().set(item.mDate.c_str());
+        dividend.append_child("Date").text().set(format_day(item.mDate).c_str());
         dividend.append_child("PayerIdentificationNumber").text().set(item.mPayer.mIsin.c_str());
         if (item.mPayer.mName) dividend.append_child("PayerName").text().set(item.mPayer.mName->c_str());
         if (item.mPayer.mAddress) dividend.append_child("PayerAddress").text().set(item.mPayer.mAddress->c_str());
@@ -121,7 +134,7 @@ pugi::xml_node XmlGenerator::generate_doh_kdvp(pugi::xml_node parent, const DohK
                 if (row.mPurchase) {
                     auto p = row_node.append_child("Purchase");
                     const auto& pu = *row.mPurchase;
-                    if (pu.mF1)  p.append_child("F1").text().set(pu.mF1->c_str());
+                    if (pu.mF1)  p.append_child("F1").text().set(format_day(*pu.mF1).c_str());
                     if (pu.mF2)  p.append_child("F2").text().set(gain_type_to_string(*pu.mF2).c_str());
                     if (pu.mF3)  p.append_child("F3").text().set(to_xml_decimal(pu.mF3.value(), 8).c_str());
                     if (pu.mF4)  p.append_child("F4").text().set(to_xml_decimal(pu.mF4.value(), 8).c_str());
@@ -132,7 +145,7 @@ pugi::xml_node XmlGenerator::generate_doh_kdvp(pugi::xml_node parent, const DohK
                 if (row.mSale) {
                     auto s = row_node.append_child("Sale");
                     const auto& sa = *row.mSale;
-                    if (sa.mF6) s.append_child("F6").text().set(sa.mF6->c_str());
+                    if (sa.mF6) s.append_child("F6").text().set(format_day(*sa.mF6).c_str());
                     if (sa.mF7) s.append_child("F7").text().set(to_xml_decimal(sa.mF7.value(), 8).c_str());
                     if (sa.mF9) s.append_child("F9").text().set(to_xml_decimal(sa.mF9.value(), 8).c_str());
                     if (sa.mF10) s.append_child("F10").text().set(*sa.mF10 ? "true" : "false");
@@ -357,102 +370,166 @@ void XmlGenerator::parse_json(Transactions& aTransactions, std::set<TransactionT
     parse_income_section(income_section, aTransactions.mIncome);
 }
 
-DohKDVP_Data XmlGenerator::prepare_kdvp_data(std::map<std::string, std::vector<GainTransaction>>& aTransactions, FormData& aFormData) {
+KDVPItem XmlGenerator::prepare_kdvp_item(const GainTransactions& aTransactions, GainTransactions::Security aSecurity,
+                                         std::span<const LotMatch> aMatches) {
+    const auto rows = aTransactions.rows(aSecurity);
+    const auto days = aTransactions.days();
+    const auto types = aTransactions.types();
+    const auto quantities = aTransactions.quantities();
+    const auto unit_prices = aTransactions.unitPrices();
+
+    KDVPItem item;
+    item.mType = InventoryListType::PLVP;  // Use full PLVP for detailed rows
+
+    item.mSecurities = SecuritiesPLVP{};
+    item.mSecurities->mISIN = std::string(aTransactions.isin(aSecurity));
+    // item.Securities->mCode = mIsin;  // Reuse as code if needed -> ticker, if we have isin we can skip this
+    item.mSecurities->mName = std::string(aTransactions.name(aSecurity));
+    item.mSecurities->mRows.reserve(rows.size());
+
+    // Purchase days in date order, searched for every sale, also for purchases after it
+    std::vector<std::int32_t> buy_days;
+    for (const auto t : rows) {
+        if (types[t] == TradeType::Buy) {
+            buy_days.push_back(days[t]);
+        }
+    }
+
+    // Build rows with running stock (mF8)
+    double running_quantity = 0.0;
+    int row_id = 0;
+    size_t next_match = 0;  // Matches follow the sales in row order
+
+    for (const auto t : rows) {
+        InventoryRow row;
+        row.ID = row_id++;
+
+        if (types[t] == TradeType::Buy) {
+            row.mPurchase = RowPurchase{};
+            row.mPurchase->mF1 = days[t];
+            row.mPurchase->mF2 = GainType::A;
+
+            row.mPurchase->mF3 = quantities[t];
+            row.mPurchase->mF4 = unit_prices[t];
+            row.mPurchase->mF5 = 0.0;  // Assume no inheritance tax
+            // mF11 if needed
+
+            running_quantity = running_quantity + quantities[t];
+        } else {
+            row.mSale = RowSale{};
+            row.mSale->mF6 = days[t];
+            row.mSale->mF7 = quantities[t];
+            row.mSale->mF9 = unit_prices[t];
+
+            double realized_gain = 0.0;
+            while (next_match < aMatches.size() && aMatches[next_match].mSellRow == t) {
+                realized_gain += aMatches[next_match++].mRealizedGain;
+            }
+
+            // losses substract gains if not bought within 30 days before or after the loss sell, gains are not restricted
+            row.mSale->mF10 = realized_gain >= 0.0 || !bought_near(buy_days, days[t]);
+
+            running_quantity = running_quantity - quantities[t];
+        }
+
+        row.mF8 = running_quantity;
+        item.mSecurities->mRows.push_back(std::move(row));
+    }
+
+    return item;
+}
+
+DohKDVP_Data XmlGenerator::prepare_kdvp_data(GainTransactions& aTransactions, FormData& aFormData, unsigned aThreadCount) {
     DohKDVP_Data data(aFormData);
 
-    int item_id = 1;
-    for (auto& [mIsin, txs] : aTransactions) {
-        // Sort transactions by date
-        std::sort(txs.begin(), txs.end(), [](const GainTransaction& a, const GainTransaction& b) {
-            return a.mDate < b.mDate;
-        });
+    // Group by ISIN and sort transactions by date, then match the sales to the purchases they sell
+    const auto lots = LotMatcher::fifo(aTransactions);
 
-        KDVPItem item;
-        item.mItemID = item_id++;
-        item.mType = InventoryListType::PLVP;  // Use full PLVP for detailed rows
-
-        item.mSecurities = SecuritiesPLVP{};
-        item.mSecurities->mISIN = mIsin;
-        // item.Securities->mCode = mIsin;  // Reuse as code if needed -> ticker, if we have isin we can skip this
-        item.mSecurities->mName = txs[0].mIsinName;       // we take firs element name, as we group by isin and all elements have same isin
-
-        // Build rows with running stock (mF8)
-        double running_quantity = 0.0;
-        int row_id = 0;
-        std::string last_buy_date;
-
-        for (const auto& t : txs) {
-            InventoryRow row;
-            row.ID = row_id++;
-
-            if (t.mType == "Trading Buy") {
-                row.mPurchase = RowPurchase{};
-                row.mPurchase->mF1 = t.mDate;
-                row.mPurchase->mF2 = GainType::A;
-
-                row.mPurchase->mF3 = t.mQuantity;
-                row.mPurchase->mF4 = t.mUnitPrice;
-                row.mPurchase->mF5 = 0.0;  // Assume no inheritance tax
-                // mF11 if needed
-
-                last_buy_date = t.mDate;
-
-                running_quantity = running_quantity + t.mQuantity;
-            } else if (t.mType == "Trading Sell") {
-                row.mSale = RowSale{};
-                row.mSale->mF6 = t.mDate;
-                row.mSale->mF7 = t.mQuantity;
-                row.mSale->mF9 = t.mUnitPrice;
-
-                // losses substract gains if not bought until 30 days from loss sell pass 
-                row.mSale->mF10 = days_between(last_buy_date, t.mDate) >= 30;  // true if bought at least 30 days before sell
-
-                running_quantity = running_quantity - t.mQuantity;
-            } else {
-                continue;  // Skip unknown types
+    // Every sold unit must come from a purchase, unmatched sales are by security in ISIN order like the items
+    if (const auto unmatched = lots.unmatched(); !unmatched.empty()) {
+        const auto security = aTransactions.securities()[unmatched.front().mSellRow];
+        throw std::invalid_argument("Sale of more units than bought earlier of " + std::string(aTransactions.isin(security)));
+    }
+
+    // Securities are independent, workers take them one at a time and the items are collected in ISIN order
+    const size_t securities = aTransactions.securityCount();
+    std::vector<KDVPItem> items(securities);
+    std::vector<std::exception_ptr> errors(securities);
+    std::atomic<size_t> next_security {0};
+    auto work = [&] {
+        for (size_t security = next_security++; security < securities; security = next_security++) {
+            try {
+                const auto id = static_cast<GainTransactions::Security>(security);
+                items[security] = prepare_kdvp_item(aTransactions, id, lots.matches(id));
+            } catch (...) {
+                errors[security] = std::current_exception();
             }
+        }
+    };
+
+    const unsigned hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+    const size_t workers_wanted = securities < KDVP_PARALLEL_MIN_SECURITIES ? 1 : (aThreadCount == 0 ? hardware_threads : aThreadCount);
+    const size_t num_workers = std::clamp<size_t>(workers_wanted, 1, std::max<size_t>(securities, 1));
+    std::vector<std::thread> workers;
+    workers.reserve(num_workers - 1);
+    for (size_t w = 1; w < num_workers; ++w) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
+    }
 
-            row.mF8 = running_quantity;
-            item.mSecurities->mRows.push_back(row);
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);  // The first security in ISIN order, like the serial loop
         }
+    }
+
+    // ItemIDs follow the ISIN order whatever worker built the item
+    int item_id = 1;
+    data.mItems.reserve(securities);
+    for (auto& item : items) {
+        item.mItemID = item_id++;
 
         // Only add if there are rows
         if (!item.mSecurities->mRows.empty()) {
-            data.mItems.push_back(item);
+            data.mItems.push_back(std::move(item));
         }
     }
 
     return data;
 }
 
-DohDiv_Data XmlGenerator::prepare_div_data(std::map<std::string, std::vector<DivTransaction>>& aTransactions, FormData& aFormData) {
+DohDiv_Data XmlGenerator::prepare_div_data(DividendTransactions& aTransactions, FormData& aFormData) {
     DohDiv_Data data(aFormData);
 
-    for (auto& [mIsin, txs] : aTransactions) {
-        // Sort transactions by date
-        std::sort(txs.begin(), txs.end(), [](const DivTransaction& a, const DivTransaction& b) {
-            return a.mDate < b.mDate;
-        });
-
-        DivItem item;
+    // Group by ISIN and sort transactions by date
+    aTransactions.sort();
+    const auto days = aTransactions.days();
+    const auto gross_incomes = aTransactions.grossIncomes();
+    const auto withholding_taxes = aTransactions.withholdingTaxes();
+    data.mItems.reserve(aTransactions.size());
 
-        for (const auto& tx : txs) {
-            item.mDate = tx.mDate;
+    for (DividendTransactions::Security security = 0; security < aTransactions.securityCount(); ++security) {
+        for (const auto tx : aTransactions.rows(security)) {
+            DivItem item;
+            item.mDate = days[tx];
 
-            item.mPayer.mIsin = mIsin;
-            item.mPayer.mName = tx.mIsinName;
+            item.mPayer.mIsin = std::string(aTransactions.isin(security));
+            item.mPayer.mName = std::string(aTransactions.name(security));
             // TODO: make country dictionary: from county name to country code
-            // std::string country_code = getCountryCode(txs[0].mCountryName);
+            // std::string country_code = getCountryCode(aTransactions.country(tx));
             // if (country_code) item.mPayer.mCountryCode = country_code;
             // if (country_code) item.mPayer.mSourceCountryCode = country_code; // move after country dic is made
 
-            item.mGrossIncome = tx.mGrossIncome;
-            item.mWithholdingTax = tx.mWitholdTax;
+            item.mGrossIncome = gross_incomes[tx];
+            item.mWithholdingTax = withholding_taxes[tx];
 
             // mType remains default for physical person dividend ("1")
             // mForeignTaxPaid remains default true
 
-            data.mItems.push_back(item);
+            data.mItems.push_back(std::move(item));
         }
     }
 
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <stdexcept>
+
+#include "line_index.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define LINE_INDEX_X86 1
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #define LINE_INDEX_TARGET_AVX2
+    #else
+        #define LINE_INDEX_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#else
+    #define LINE_INDEX_X86 0
+#endif
+
+namespace {
+    constexpr size_t BLOCK_BYTES = 32; // Bytes per mask, one AVX2 register or two SSE2 registers
+    constexpr std::uint32_t NO_TEXT = std::numeric_limits<std::uint32_t>::max();
+
+    // Collects lines from bit masks over consecutive blocks of the text, bit i standing for byte aBase + i
+    class LineBuilder {
+        public:
+            explicit LineBuilder(std::vector<LineIndex::Bounds>& aLines) : mLines {aLines} {}
+
+            void block(std::uint32_t aBase, std::uint32_t aNewlines, std::uint32_t aNonSpace) {
+                while (aNewlines != 0) {
+                    const auto bit = std::countr_zero(aNewlines);
+                    addText(aBase, aNonSpace & ((std::uint32_t {1} << bit) - 1));
+                    endLine(aBase + bit);
+                    aNonSpace &= ~((std::uint32_t {2} << bit) - 1); // 2 << 31 wraps to 0, clearing every bit
+                    aNewlines &= aNewlines - 1;
+                }
+                addText(aBase, aNonSpace);
+            }
+
+            void finish(std::uint32_t aSize) {
+                if (mBegin < aSize) {
+                    endLine(aSize);
+                }
+            }
+
+        private:
+            std::vector<LineIndex::Bounds>& mLines;
+            std::uint32_t mBegin {0};
+            std::uint32_t mTextBegin {NO_TEXT};
+            std::uint32_t mTextEnd {0};
+
+            void addText(std::uint32_t aBase, std::uint32_t aNonSpace) {
+                if (aNonSpace == 0) {
+                    return;
+                }
+                if (mTextBegin == NO_TEXT) {
+                    mTextBegin = aBase + std::countr_zero(aNonSpace);
+                }
+                mTextEnd = aBase + 32 - std::countl_zero(aNonSpace);
+            }
+
+            void endLine(std::uint32_t aEnd) {
+                if (mTextBegin == NO_TEXT) {
+                    mLines.push_back({mBegin, aEnd, aEnd, aEnd});
+                } else {
+                    mLines.push_back({mBegin, aEnd, mTextBegin, mTextEnd});
+                }
+                mBegin = aEnd + 1;
+                mTextBegin = NO_TEXT;
+            }
+    };
+
+    bool isSpace(char aChar) {
+        return aChar == ' ' || (aChar >= '\t' && aChar <= '\r');
+    }
+
+    // Masks of the tail shorter than BLOCK_BYTES the vector loops leave over
+    void scalarBlock(const char* aData, size_t aCount, std::uint32_t aBase, LineBuilder& aBuilder) {
+        std::uint32_t newlines {0};
+        std::uint32_t nonSpace {0};
+        for (size_t i = 0; i < aCount; ++i) {
+            newlines |= static_cast<std::uint32_t>(aData[i] == '\n') << i;
+            nonSpace |= static_cast<std::uint32_t>(!isSpace(aData[i])) << i;
+        }
+        aBuilder.block(aBase, newlines, nonSpace);
+    }
+
+    // Without vector registers masks do not pay off, memchr and a trim per line are faster
+    void scanScalar(std::string_view aText, std::vector<LineIndex::Bounds>& aLines) {
+        constexpr std::string_view WHITESPACE = " \t\n\v\f\r";
+        for (size_t begin = 0; begin < aText.size();) {
+            const auto end = std::min(aText.find('\n', begin), aText.size());
+            const auto line = aText.substr(begin, end - begin);
+            const auto first = line.find_first_not_of(WHITESPACE);
+            const auto lineBegin = static_cast<std::uint32_t>(begin);
+            const auto lineEnd = static_cast<std::uint32_t>(end);
+            if (first == std::string_view::npos) {
+                aLines.push_back({lineBegin, lineEnd, lineEnd, lineEnd});
+            } else {
+                const auto last = line.find_last_not_of(WHITESPACE);
+                aLines.push_back({lineBegin, lineEnd, static_cast<std::uint32_t>(begin + first), static_cast<std::uint32_t>(begin + last + 1)});
+            }
+            begin = end + 1;
+        }
+    }
+
+#if LINE_INDEX_X86
+    std::uint32_t sse2Mask(__m128i aBytes, std::uint32_t& aNonSpace) {
+        // ' ' or '\t'..'\r', the unsigned range test is done with min/max as SSE2 has no unsigned compare
+        const auto space = _mm_cmpeq_epi8(aBytes, _mm_set1_epi8(' '));
+        const auto aboveTab = _mm_cmpeq_epi8(_mm_max_epu8(aBytes, _mm_set1_epi8('\t')), aBytes);
+        const auto belowCr = _mm_cmpeq_epi8(_mm_min_epu8(aBytes, _mm_set1_epi8('\r')), aBytes);
+        const auto whitespace = _mm_or_si128(space, _mm_and_si128(aboveTab, belowCr));
+        aNonSpace = ~static_cast<std::uint32_t>(_mm_movemask_epi8(whitespace)) & 0xFFFF;
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(aBytes, _mm_set1_epi8('\n'))));
+    }
+
+    size_t scanSse2(std::string_view aText, LineBuilder& aBuilder) {
+        size_t offset {0};
+        for (; offset + BLOCK_BYTES <= aText.size(); offset += BLOCK_BYTES) {
+            std::uint32_t lowNonSpace {0};
+            std::uint32_t highNonSpace {0};
+            const auto* data = reinterpret_cast<const __m128i*>(aText.data() + offset);
+            const auto lowNewlines = sse2Mask(_mm_loadu_si128(data), lowNonSpace);
+            const auto highNewlines = sse2Mask(_mm_loadu_si128(data + 1), highNonSpace);
+            aBuilder.block(static_cast<std::uint32_t>(offset), lowNewlines | (highNewlines << 16), lowNonSpace | (highNonSpace << 16));
+        }
+        return offset;
+    }
+
+    LINE_INDEX_TARGET_AVX2 size_t scanAvx2(std::string_view aText, LineBuilder& aBuilder) {
+        size_t offset {0};
+        for (; offset + BLOCK_BYTES <= aText.size(); offset += BLOCK_BYTES) {
+            const auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aText.data() + offset));
+            const auto space = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' '));
+            const auto aboveTab = _mm256_cmpeq_epi8(_mm256_max_epu8(bytes, _mm256_set1_epi8('\t')), bytes);
+            const auto belowCr = _mm256_cmpeq_epi8(_mm256_min_epu8(bytes, _mm256_set1_epi8('\r')), bytes);
+            const auto whitespace = _mm256_or_si256(space, _mm256_and_si256(aboveTab, belowCr));
+            const auto newlines = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n'));
+            aBuilder.block(static_cast<std::uint32_t>(offset), static_cast<std::uint32_t>(_mm256_movemask_epi8(newlines)),
+                           ~static_cast<std::uint32_t>(_mm256_movemask_epi8(whitespace)));
+        }
+        return offset;
+    }
+
+    bool cpuHasAvx2() {
+    #ifdef _MSC_VER
+        int info[4] {};
+        __cpuid(info, 0);
+        if (info[0] < 7) {
+            return false;
+        }
+        __cpuid(info, 1);
+        const bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6; // OSXSAVE, XMM and YMM state
+        __cpuidex(info, 7, 0);
+        return osSavesYmm && (info[1] & (1 << 5)) != 0;
+    #else
+        return __builtin_cpu_supports("avx2");
+    #endif
+    }
+#endif
+}
+
+LineIndex::LineIndex(std::string_view aText) : LineIndex {aText, bestIsa()} {}
+
+LineIndex::LineIndex(std::string_view aText, Isa aIsa) : mText {aText} {
+    if (aText.size() >= NO_TEXT) {
+        throw std::runtime_error {"Text too large to index its lines"};
+    }
+    if (!supported(aIsa)) {
+        throw std::runtime_error {"Instruction set not supported by this CPU"};
+    }
+
+    mLines.reserve(aText.size() / 48); // Report lines average somewhat more
+    if (aIsa == Isa::Scalar) {
+        scanScalar(aText, mLines);
+        return;
+    }
+
+    LineBuilder builder {mLines};
+    size_t scanned {0};
+#if LINE_INDEX_X86
+    scanned = aIsa == Isa::Avx2 ? scanAvx2(aText, builder) : scanSse2(aText, builder);
+#endif
+    scalarBlock(aText.data() + scanned, aText.size() - scanned, static_cast<std::uint32_t>(scanned), builder);
+    builder.finish(static_cast<std::uint32_t>(aText.size()));
+}
+
+std::string_view LineIndex::raw(size_t aLine) const {
+    const auto& line = mLines[aLine];
+    return mText.substr(line.mBegin, line.mEnd - line.mBegin);
+}
+
+std::string_view LineIndex::text(size_t aLine) const {
+    const auto& line = mLines[aLine];
+    return mText.substr(line.mTextBegin, line.mTextEnd - line.mTextBegin);
+}
+
+LineIndex::Isa LineIndex::bestIsa() {
+    static const Isa best = [] {
+        for (const auto isa : {Isa::Avx2, Isa::Sse2}) {
+            if (supported(isa)) {
+                return isa;
+            }
+        }
+        return Isa::Scalar;
+    }();
+    return best;
+}
+
+bool LineIndex::supported(Isa aIsa) {
+#if LINE_INDEX_X86
+    switch (aIsa) {
+        case Isa::Avx2:
+            return cpuHasAvx2();
+        case Isa::Sse2:
+            return true; // Part of x86-64
+        case Isa::Scalar:
+            return true;
+    }
+    return false;
+#else
+    return aIsa == Isa::Scalar;
+#endif
+}
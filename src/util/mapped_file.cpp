@@ -0,0 +1,120 @@
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::filesystem::path& aPath) {
+    HANDLE file = CreateFileW(aPath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error {"Failed to open file for mapping: " + aPath.string()};
+    }
+
+    LARGE_INTEGER size {};
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        throw std::runtime_error {"Failed to read file size: " + aPath.string()};
+    }
+    mSize = static_cast<size_t>(size.QuadPart);
+
+    // Empty files cannot be mapped, they are represented by an empty view
+    if (mSize > 0) {
+        mMapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mMapping) {
+            mData = static_cast<const char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+        }
+    }
+    CloseHandle(file);
+
+    if (mSize > 0 && !mData) {
+        unmap();
+        throw std::runtime_error {"Failed to map file: " + aPath.string()};
+    }
+}
+
+void MappedFile::unmap() noexcept {
+    if (mData) {
+        UnmapViewOfFile(mData);
+    }
+    if (mMapping) {
+        CloseHandle(mMapping);
+    }
+    mData = nullptr;
+    mMapping = nullptr;
+    mSize = 0;
+}
+#else
+MappedFile::MappedFile(const std::filesystem::path& aPath) {
+    const int fd = ::open(aPath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error {"Failed to open file for mapping: " + aPath.string()};
+    }
+
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error {"Failed to read file size: " + aPath.string()};
+    }
+    mSize = static_cast<size_t>(info.st_size);
+
+    // Empty files cannot be mapped, they are represented by an empty view
+    if (mSize > 0) {
+        void* data = ::mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            ::close(fd);
+            mSize = 0;
+            throw std::runtime_error {"Failed to map file: " + aPath.string()};
+        }
+        // Lines are consumed front to back, let the kernel read ahead and drop pages behind
+        ::madvise(data, mSize, MADV_SEQUENTIAL);
+        mData = static_cast<const char*>(data);
+    }
+    // The mapping keeps the file referenced, the descriptor is not needed anymore
+    ::close(fd);
+}
+
+void MappedFile::unmap() noexcept {
+    if (mData) {
+        ::munmap(const_cast<char*>(mData), mSize);
+    }
+    mData = nullptr;
+    mSize = 0;
+}
+#endif
+
+MappedFile::~MappedFile() {
+    unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& aOther) noexcept
+    : mData {std::exchange(aOther.mData, nullptr)}, mSize {std::exchange(aOther.mSize, 0)}
+#ifdef _WIN32
+    , mMapping {std::exchange(aOther.mMapping, nullptr)}
+#endif
+{}
+
+MappedFile& MappedFile::operator=(MappedFile&& aOther) noexcept {
+    if (this != &aOther) {
+        unmap();
+        mData = std::exchange(aOther.mData, nullptr);
+        mSize = std::exchange(aOther.mSize, 0);
+        #ifdef _WIN32
+        mMapping = std::exchange(aOther.mMapping, nullptr);
+        #endif
+    }
+    return *this;
+}
@@ -0,0 +1,124 @@
+#include <charconv>
+#include <limits>
+#include <optional>
+#include <system_error>
+
+#include "number_parser.hpp"
+
+namespace {
+    using numbers::ParseStatus;
+
+    constexpr size_t MAX_NUMBER_LENGTH = 64; // Far longer than any amount in a report
+    constexpr std::string_view SKIPPED_CHARS = ", \t\n\v\f\r";
+
+    struct Compacted {
+        std::string_view mDigits; // Without sign
+        bool mNegative {false};
+    };
+
+    // Drops separators and whitespace, copying into aBuffer only when there are any, and splits off the sign
+    std::optional<Compacted> compact(std::string_view aText, char (&aBuffer)[MAX_NUMBER_LENGTH], ParseStatus& aStatus) {
+        if (aText.find_first_of(SKIPPED_CHARS) != std::string_view::npos) {
+            size_t length {0};
+            for (const char c : aText) {
+                if (SKIPPED_CHARS.find(c) != std::string_view::npos) {
+                    continue;
+                }
+                if (length == MAX_NUMBER_LENGTH) {
+                    aStatus = ParseStatus::OutOfRange;
+                    return std::nullopt;
+                }
+                aBuffer[length++] = c;
+            }
+            aText = {aBuffer, length};
+        }
+
+        Compacted result;
+        if (!aText.empty() && (aText.front() == '-' || aText.front() == '+')) {
+            result.mNegative = aText.front() == '-';
+            aText.remove_prefix(1);
+        }
+        if (aText.empty()) {
+            aStatus = result.mNegative ? ParseStatus::Invalid : ParseStatus::Empty;
+            return std::nullopt;
+        }
+        if (aText.front() == '-' || aText.front() == '+') {
+            aStatus = ParseStatus::Invalid; // from_chars would take a second sign
+            return std::nullopt;
+        }
+        result.mDigits = aText;
+        return result;
+    }
+
+    bool allDigits(std::string_view aText) {
+        return aText.find_first_not_of("0123456789") == std::string_view::npos;
+    }
+}
+
+namespace numbers {
+    ParseStatus parseDouble(std::string_view aText, double& aValue) {
+        char buffer[MAX_NUMBER_LENGTH];
+        ParseStatus status {ParseStatus::Ok};
+        const auto number = compact(aText, buffer, status);
+        if (!number) {
+            return status;
+        }
+
+        const auto* first = number->mDigits.data();
+        const auto* last = first + number->mDigits.size();
+        double value {0.0};
+        const auto [end, error] = std::from_chars(first, last, value);
+        if (error == std::errc::result_out_of_range) {
+            return ParseStatus::OutOfRange;
+        }
+        if (error != std::errc {} || end != last) {
+            return ParseStatus::Invalid;
+        }
+        aValue = number->mNegative ? -value : value;
+        return ParseStatus::Ok;
+    }
+
+    ParseStatus parseCents(std::string_view aText, std::int64_t& aCents) {
+        char buffer[MAX_NUMBER_LENGTH];
+        ParseStatus status {ParseStatus::Ok};
+        const auto number = compact(aText, buffer, status);
+        if (!number) {
+            return status;
+        }
+
+        auto units = number->mDigits;
+        std::string_view fraction {};
+        if (const auto point = units.find('.'); point != std::string_view::npos) {
+            fraction = units.substr(point + 1);
+            units = units.substr(0, point);
+        }
+        // "5." and ".5" are numbers, "." is not
+        if ((units.empty() && fraction.empty()) || !allDigits(units) || !allDigits(fraction)) {
+            return ParseStatus::Invalid;
+        }
+
+        std::uint64_t whole {0};
+        if (!units.empty()) {
+            const auto [end, error] = std::from_chars(units.data(), units.data() + units.size(), whole);
+            if (error != std::errc {}) {
+                return ParseStatus::OutOfRange;
+            }
+        }
+
+        std::uint64_t cents {0};
+        for (size_t i = 0; i < 2; ++i) {
+            cents = cents * 10 + (i < fraction.size() ? static_cast<std::uint64_t>(fraction[i] - '0') : 0);
+        }
+        if (fraction.size() > 2 && fraction[2] >= '5') {
+            ++cents; // The rest is at least half a cent
+        }
+
+        constexpr auto LIMIT = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+        if (whole > (LIMIT - cents) / 100) {
+            return ParseStatus::OutOfRange;
+        }
+        const auto magnitude = static_cast<std::int64_t>(whole * 100 + cents);
+        aCents = number->mNegative ? -magnitude : magnitude;
+        return ParseStatus::Ok;
+    }
+}
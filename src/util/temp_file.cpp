@@ -0,0 +1,67 @@
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+    #include <fcntl.h>
+    #include <io.h>
+    #include <random>
+    #include <share.h>
+    #include <sys/stat.h>
+#else
+    #include <cstdlib>
+    #include <unistd.h>
+#endif
+
+#include "temp_file.hpp"
+
+TempFile::TempFile(const std::filesystem::path& aDirectory, const std::string& aPrefix) {
+#ifdef _WIN32
+    thread_local std::mt19937_64 random {std::random_device {}()};
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        auto path = aDirectory / (aPrefix + std::to_string(random()));
+        int fd {-1};
+        const auto error = _wsopen_s(&fd, path.c_str(), _O_CREAT | _O_EXCL | _O_WRONLY | _O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE);
+        if (error == 0) {
+            _close(fd);
+            mPath = std::move(path);
+            return;
+        }
+        if (error != EEXIST) {
+            break;
+        }
+    }
+#else
+    auto pattern = (aDirectory / (aPrefix + "XXXXXX")).string();
+    const int fd = mkstemp(pattern.data());
+    if (fd != -1) {
+        close(fd);
+        mPath = std::move(pattern);
+        return;
+    }
+#endif
+    throw std::runtime_error {"Failed to create temporary file in " + aDirectory.string()};
+}
+
+TempFile::~TempFile() {
+    remove();
+}
+
+TempFile::TempFile(TempFile&& aOther) noexcept : mPath {std::exchange(aOther.mPath, {})} {}
+
+TempFile& TempFile::operator=(TempFile&& aOther) noexcept {
+    if (this != &aOther) {
+        remove();
+        mPath = std::exchange(aOther.mPath, {});
+    }
+    return *this;
+}
+
+void TempFile::remove() noexcept {
+    if (!mPath.empty()) {
+        std::error_code error;
+        std::filesystem::remove(mPath, error); // A file already gone is not an error for a cleanup
+        mPath.clear();
+    }
+}
@@ -1,48 +1,55 @@
 #include "util_xml.hpp"
 #include <algorithm>
+#include <charconv>
 
-static void parse_div_section(const nlohmann::json& div_section,  std::map<std::string, std::vector<DivTransaction>>& aTransactions, std::string country_name);
+static void parse_div_section(const nlohmann::json& div_section, DividendTransactions& aTransactions, std::string country_name);
 static void parse_interests_section(const nlohmann::json& interests_section,  std::map<std::string, std::vector<DhoTransaction>>& aTransactions);
 
-// Helper function to parse date from DD.MM.YYYY to YYYY-MM-DD
-std::string parse_date(const std::string& date_str) {
-    if (date_str.empty()) return "";
-    std::tm tm = {};
-    std::istringstream ss(date_str);
-    ss.imbue(std::locale("C"));
-    ss >> std::get_time(&tm, "%d.%m.%Y");
-    if (ss.fail()) {
-        throw std::runtime_error("Failed to parse date: " + date_str);
-    }
-    std::ostringstream oss;
-    oss.imbue(std::locale("C"));
-    oss << std::put_time(&tm, "%Y-%m-%d");
-    return oss.str();
-}
-
-// Helper to calculate days between two dates in YYYY-MM-DD format
-int days_between(const std::string& from, const std::string& to)
-{
+// Helper to parse date from DD.MM.YYYY to a day number (days since 1970-01-01)
+std::int32_t parse_day(std::string_view date_str) {
     using namespace std::chrono;
 
-    auto parse = [](const std::string& s) -> sys_days {
-        int y, m, d;
-        if (std::sscanf(s.c_str(), "%d-%d-%d", &y, &m, &d) != 3)
-            throw std::invalid_argument("Invalid date format");
+    int parts[3] {};
+    const char* pos = date_str.data();
+    const char* end = date_str.data() + date_str.size();
+    for (int i = 0; i < 3; ++i) {
+        if (i > 0) {
+            if (pos == end || *pos != '.') {
+                throw std::runtime_error("Failed to parse date: " + std::string(date_str));
+            }
+            ++pos;
+        }
+        const auto [next, error] = std::from_chars(pos, end, parts[i]);
+        if (error != std::errc {} || next == pos) {
+            throw std::runtime_error("Failed to parse date: " + std::string(date_str));
+        }
+        pos = next;
+    }
 
-        year_month_day ymd{
-            year{y},
-            month{static_cast<unsigned>(m)},
-            day{static_cast<unsigned>(d)}
-        };
+    const year_month_day ymd {year {parts[2]}, month {static_cast<unsigned>(parts[1])}, day {static_cast<unsigned>(parts[0])}};
+    if (pos != end || !ymd.ok() || parts[2] < 1 || parts[2] > 9999) {
+        throw std::runtime_error("Failed to parse date: " + std::string(date_str));
+    }
+    return static_cast<std::int32_t>(sys_days {ymd}.time_since_epoch().count());
+}
 
-        if (!ymd.ok())
-            throw std::invalid_argument("Invalid calendar date");
+// Helper to format a day number as YYYY-MM-DD
+DayText format_day(std::int32_t day) {
+    using namespace std::chrono;
 
-        return sys_days{ymd};
+    const year_month_day ymd {sys_days {days {day}}};
+    DayText text;
+    auto put = [&text](size_t pos, unsigned value, size_t digits) {
+        for (size_t i = digits; i-- > 0; value /= 10) {
+            text.mText[pos + i] = static_cast<char>('0' + value % 10);
+        }
     };
-
-    return (parse(to) - parse(from)).count();
+    put(0, static_cast<unsigned>(static_cast<int>(ymd.year())), 4);
+    text.mText[4] = '-';
+    put(5, static_cast<unsigned>(ymd.month()), 2);
+    text.mText[7] = '-';
+    put(8, static_cast<unsigned>(ymd.day()), 2);
+    return text;
 }
 
 // Helper to extract ISIN code and name from "ISIN - Name" format
@@ -67,6 +74,13 @@ TransactionType string_to_asset_type(std::string mType) {
     return TransactionType::None;
 }
 
+std::optional<TradeType> string_to_trade_type(std::string_view mType) {
+    if (mType == "Trading Buy") return TradeType::Buy;
+    if (mType == "Trading Sell") return TradeType::Sell;
+
+    return std::nullopt;
+}
+
 // Helper to get string from FormType enum
 std::string form_type_to_string(FormType t) {
     if (t == FormType::Original) return "Original";
@@ -87,7 +101,7 @@ std::string to_xml_decimal(double value, int precision) {
     return oss.str();
 }
 
-void parse_gains_section(const nlohmann::json& gains_section, std::set<TransactionType> aTypes, std::map<std::string, std::vector<GainTransaction>>& aTransactions) {
+void parse_gains_section(const nlohmann::json& gains_section, std::set<TransactionType> aTypes, GainTransactions& aTransactions) {
     for (const auto& entry : gains_section) {
         if (!entry.contains("transactions") || !entry["transactions"].is_array()) continue;
 
@@ -100,31 +114,32 @@ void parse_gains_section(const nlohmann::json& gains_section, std::set<Transacti
                 continue;  // Skip invalid transactions
             }
 
+            const auto type = string_to_trade_type(tx["transaction_type"].get<std::string>());
+            if (!type) {
+                continue;  // Skip unknown types
+            }
+
             std::string isin_str = tx["isin"];
             std::string isin_code;
             std::string name;
             parse_isin(isin_str, isin_code, name);
 
-            GainTransaction t;
-            t.mDate = parse_date(tx["transaction_date"].get<std::string>());
-            t.mType = tx["transaction_type"].get<std::string>();
-            t.mQuantity = tx["amount_of_units"].get<double>();
-            t.mIsin = isin_code;
-            t.mIsinName = name;
+            const double quantity = tx["amount_of_units"].get<double>();
+            double unit_price = 0.0;
 
             // Get unit_price: prefer "unit_price", fallback to "market_value" / quantity
             if (tx.contains("unit_price")) {
-                t.mUnitPrice = tx["unit_price"].get<double>();
+                unit_price = tx["unit_price"].get<double>();
             } 
             else if (tx.contains("market_value")) {
                 double market_value = tx["market_value"].get<double>();
-                t.mUnitPrice = (t.mQuantity != 0.0) ? market_value / t.mQuantity : 0.0;
+                unit_price = (quantity != 0.0) ? market_value / quantity : 0.0;
             } 
             else {
                 continue;  // Skip if no price info
             }
 
-            aTransactions[isin_code].push_back(t);
+            aTransactions.add(isin_code, name, parse_day(tx["transaction_date"].get<std::string>()), *type, quantity, unit_price);
         }
     }
 }
@@ -145,7 +160,7 @@ void parse_income_section(const nlohmann::json& income_section, IncomeTransactio
     }
 }
 
-static void parse_div_section(const nlohmann::json& div_section,  std::map<std::string, std::vector<DivTransaction>>& aTransactions, std::string country_name) {
+static void parse_div_section(const nlohmann::json& div_section, DividendTransactions& aTransactions, std::string country_name) {
     for (const auto& tx : div_section["transactions"]) {
 
         std::string isin_str = tx["isin"];
@@ -153,15 +168,8 @@ static void parse_div_section(const nlohmann::json& div_section,  std::map<std::
         std::string name;
         parse_isin(isin_str, isin_code, name);
 
-        DivTransaction t;
-        t.mDate = parse_date(tx["value_date"].get<std::string>());
-        t.mIsin = isin_code;
-        t.mIsinName = name;
-        t.mGrossIncome = tx["gross_income"].get<double>();
-        t.mWitholdTax = tx["withholding_tax"].get<double>();
-        t.mCountryName = country_name;
-
-        aTransactions[isin_code].push_back(t);
+        aTransactions.add(isin_code, name, parse_day(tx["value_date"].get<std::string>()), country_name,
+                          tx["gross_income"].get<double>(), tx["withholding_tax"].get<double>());
     }
 }
 
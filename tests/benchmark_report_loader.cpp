@@ -0,0 +1,416 @@
+// Micro benchmarks of the report parsing hot paths, run on the pre-extracted test report
+// (line splitting on a multi-megabyte report made of it, the gains store on a synthetic savings plan portfolio).
+// Not part of ctest, build the benchmark_report_loader target (make benchmark) in Release mode and run it.
+#include <report_lines.hpp>
+#include <number_parser.hpp>
+#include <line_index.hpp>
+#include <lot_matcher.hpp>
+#include <transaction_store.hpp>
+#include <util_xml.hpp>
+#include <xml_generator.hpp>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <ranges>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    const std::filesystem::path projectRoot {PROJECT_SOURCE_DIR};
+    const std::filesystem::path txtPdfData = projectRoot / "tests" / "testData" / "generated_test_data.txt";
+
+    constexpr int ROUNDS = 200;
+    constexpr int TEXT_ROUNDS = 10;                            // Rounds over the synthetic report
+    constexpr size_t SYNTHETIC_REPORT_BYTES = 8 * 1024 * 1024; // Test report repeated up to this size
+    constexpr size_t PORTFOLIO_TRADES = 100'000;               // Monthly savings plan buys spread over the securities
+    constexpr size_t PORTFOLIO_SECURITIES = 250;
+    constexpr size_t MICRO_TRADES = 500'000;                   // Crypto account, fractional buys and sells of a few coins
+    constexpr size_t MICRO_SECURITIES = 4;
+
+    size_t gSink {0}; // Keeps the optimizer from dropping the measured work
+
+    std::vector<std::string> trimmedReportLines() {
+        std::ifstream file {txtPdfData};
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(file, line);) {
+            const auto begin = line.find_first_not_of(" \t\n\v\f\r");
+            const auto end = line.find_last_not_of(" \t\n\v\f\r");
+            if (begin != std::string::npos) {
+                lines.push_back(line.substr(begin, end - begin + 1));
+            }
+        }
+        return lines;
+    }
+
+    void report(const std::string& aName, size_t aItems, const char* aUnit, const std::function<void()>& aRun, int aRounds = ROUNDS) {
+        aRun(); // Warm up
+        const auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < aRounds; ++round) {
+            aRun();
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        const auto perSecond = static_cast<double>(aItems) * aRounds / elapsed.count();
+        std::cout << std::left << std::setw(48) << aName << std::right << std::setw(14) << std::fixed << std::setprecision(0)
+                  << perSecond << ' ' << aUnit << "/s\n";
+    }
+
+    // One regex_match after the other, what the gains parser did before the line grammars
+    void benchmarkGainsRegexChain(const std::vector<std::string>& aLines) {
+        const std::string grouped = R"((-?\d{1,3}(?:,\d{3})*(?:\.\d+)?))";
+        const std::vector<std::regex> chain {
+            std::regex {R"(^([IVX]+\.)\s+(.+)$)"},
+            std::regex {R"(^Asset Type: (.+)$)"},
+            std::regex {R"(^Country: (.+)$)"},
+            std::regex {R"(^([A-Z0-9]+ - .+)$)"},
+            std::regex {"^(Gains|Losses)\\s+EUR\\s+" + grouped + "\\s+" + grouped + "\\s+" + grouped + "$"},
+            std::regex {R"(^(Trading Buy|Trading Sell)\s+(\d{2}\.\d{2}\.\d{4})\s+)" + grouped + R"(\s+)" + grouped + R"(\s*$)"},
+            std::regex {R"(^Report ID:\s+(.+)$)"},
+        };
+        report("gains lines, std::regex chain", aLines.size(), "lines", [&] {
+            std::smatch match;
+            for (const auto& line : aLines) {
+                for (size_t kind = 0; kind < chain.size(); ++kind) {
+                    if (std::regex_match(line, match, chain[kind])) {
+                        gSink += kind;
+                        break;
+                    }
+                }
+            }
+        });
+    }
+
+    // Kind of the first grammar of a Classifier that matches, trying its grammars in turn
+    template <typename Classifier>
+    struct InTurn;
+
+    template <typename... Grammars>
+    struct InTurn<grammar::Classifier<Grammars...>> {
+        static size_t firstMatch(std::string_view aLine) {
+            size_t kind {0};
+            ((Grammars::matches(aLine) ? true : (++kind, false)) || ...);
+            return kind;
+        }
+    };
+
+    template <typename Classifier>
+    void benchmarkClassifier(const std::string& aSection, const std::vector<std::string>& aLines) {
+        report(aSection + " lines, grammars in turn", aLines.size(), "lines", [&] {
+            for (const auto& line : aLines) {
+                gSink += InTurn<Classifier>::firstMatch(line);
+            }
+        });
+        report(aSection + " lines, single pass classifier", aLines.size(), "lines", [&] {
+            for (const auto& line : aLines) {
+                gSink += Classifier::classify(line).mKind;
+            }
+        });
+    }
+
+    // Number tokens of the report, as the parsers hand them to parseDouble
+    std::vector<std::string> reportNumbers(const std::vector<std::string>& aLines) {
+        std::vector<std::string> tokens;
+        for (const auto& line : aLines) {
+            size_t pos {0};
+            while ((pos = line.find_first_of("-0123456789", pos)) != std::string::npos) {
+                const auto end = std::min(line.find_first_of(" \t", pos), line.size());
+                tokens.push_back(line.substr(pos, end - pos));
+                pos = end;
+            }
+        }
+        return tokens;
+    }
+
+    // ReportLoader::parseDouble before numbers::parseDouble
+    std::optional<double> parseDoubleWithStod(const std::string& aValue) {
+        std::string s = aValue;
+        s.erase(std::remove(s.begin(), s.end(), ','), s.end());
+        s.erase(std::remove_if(s.begin(), s.end(), ::isspace), s.end());
+        try {
+            size_t pos;
+            double result = std::stod(s, &pos);
+            if (pos == s.length()) {
+                return result;
+            }
+        } catch (...) {
+        }
+        return std::nullopt;
+    }
+
+    void benchmarkNumbers(const std::vector<std::string>& aNumbers) {
+        report("numbers, copy + std::stod", aNumbers.size(), "numbers", [&] {
+            for (const auto& number : aNumbers) {
+                gSink += static_cast<size_t>(parseDoubleWithStod(number).value_or(0.0));
+            }
+        });
+        report("numbers, numbers::parseDouble", aNumbers.size(), "numbers", [&] {
+            for (const auto& number : aNumbers) {
+                double value {0.0};
+                numbers::parseDouble(number, value);
+                gSink += static_cast<size_t>(value);
+            }
+        });
+        report("numbers, numbers::parseCents", aNumbers.size(), "numbers", [&] {
+            for (const auto& number : aNumbers) {
+                std::int64_t cents {0};
+                numbers::parseCents(number, cents);
+                gSink += static_cast<size_t>(cents);
+            }
+        });
+    }
+
+    // DD.MM.YYYY tokens of the report
+    std::vector<std::string> reportDates(const std::vector<std::string>& aLines) {
+        const std::regex date {R"(\d{2}\.\d{2}\.\d{4})"};
+        std::vector<std::string> dates;
+        for (const auto& line : aLines) {
+            for (auto it = std::sregex_iterator(line.begin(), line.end(), date); it != std::sregex_iterator(); ++it) {
+                dates.push_back(it->str());
+            }
+        }
+        return dates;
+    }
+
+    // Date handling before day numbers: parse_date to YYYY-MM-DD through string streams, days_between scanning both again
+    std::string parseDateWithStreams(const std::string& aDate) {
+        std::tm tm = {};
+        std::istringstream ss(aDate);
+        ss.imbue(std::locale("C"));
+        ss >> std::get_time(&tm, "%d.%m.%Y");
+        std::ostringstream oss;
+        oss.imbue(std::locale("C"));
+        oss << std::put_time(&tm, "%Y-%m-%d");
+        return oss.str();
+    }
+
+    int daysBetweenWithSscanf(const std::string& aFrom, const std::string& aTo) {
+        auto parse = [](const std::string& s) {
+            int y, m, d;
+            std::sscanf(s.c_str(), "%d-%d-%d", &y, &m, &d);
+            return std::chrono::sys_days {std::chrono::year_month_day {std::chrono::year {y}, std::chrono::month {static_cast<unsigned>(m)},
+                                                                       std::chrono::day {static_cast<unsigned>(d)}}};
+        };
+        return (parse(aTo) - parse(aFrom)).count();
+    }
+
+    // Parsing every report date, one 30 day check against the date before it and writing it as XML text
+    void benchmarkDates(const std::vector<std::string>& aDates) {
+        report("dates, string streams + sscanf", aDates.size(), "dates", [&] {
+            std::string previous = parseDateWithStreams(aDates.front());
+            for (const auto& text : aDates) {
+                auto date = parseDateWithStreams(text);
+                gSink += static_cast<size_t>(daysBetweenWithSscanf(previous, date) >= 30) + date.size();
+                previous = std::move(date);
+            }
+        });
+        report("dates, parse_day + format_day", aDates.size(), "dates", [&] {
+            std::int32_t previous = parse_day(aDates.front());
+            for (const auto& text : aDates) {
+                const auto day = parse_day(text);
+                gSink += static_cast<size_t>(day - previous >= 30) + format_day(day).view().size();
+                previous = day;
+            }
+        });
+    }
+
+    std::string syntheticReport() {
+        std::ifstream file {txtPdfData};
+        const std::string page {std::istreambuf_iterator<char> {file}, std::istreambuf_iterator<char> {}};
+        std::string text;
+        text.reserve(SYNTHETIC_REPORT_BYTES + page.size());
+        while (!page.empty() && text.size() < SYNTHETIC_REPORT_BYTES) {
+            text += page;
+        }
+        return text;
+    }
+
+    // Splitting the whole report into lines and trimming them, the parsers' first step on every line
+    void benchmarkLineSplitting(const std::string& aText) {
+        const auto megabytes = aText.size() / (1024 * 1024);
+        report("lines, std::getline + ranges trim", megabytes, "MB", [&] {
+            std::istringstream stream {aText};
+            auto isSpace = [](unsigned char c) { return std::isspace(c) != 0; };
+            for (std::string line; std::getline(stream, line);) {
+                auto trimmed = line | std::views::drop_while(isSpace) | std::views::reverse | std::views::drop_while(isSpace)
+                               | std::views::reverse;
+                gSink += static_cast<size_t>(std::ranges::distance(trimmed));
+            }
+        }, TEXT_ROUNDS);
+        report("lines, string_view find + find_first_not_of", megabytes, "MB", [&] {
+            const std::string_view text {aText};
+            for (size_t offset = 0; offset < text.size();) {
+                const auto end = std::min(text.find('\n', offset), text.size());
+                const auto line = text.substr(offset, end - offset);
+                const auto begin = line.find_first_not_of(" \t\n\v\f\r");
+                if (begin != std::string_view::npos) {
+                    gSink += line.find_last_not_of(" \t\n\v\f\r") + 1 - begin;
+                }
+                offset = end + 1;
+            }
+        }, TEXT_ROUNDS);
+
+        const std::vector<std::pair<LineIndex::Isa, const char*>> isas {
+            {LineIndex::Isa::Scalar, "lines, LineIndex scalar"},
+            {LineIndex::Isa::Sse2, "lines, LineIndex SSE2"},
+            {LineIndex::Isa::Avx2, "lines, LineIndex AVX2"},
+        };
+        for (const auto& [isa, name] : isas) {
+            if (!LineIndex::supported(isa)) {
+                std::cout << name << " not supported by this CPU\n";
+                continue;
+            }
+            report(name, megabytes, "MB", [&] {
+                const LineIndex index {aText, isa};
+                for (size_t i = 0; i < index.size(); ++i) {
+                    gSink += index[i].mTextEnd - index[i].mTextBegin;
+                }
+            }, TEXT_ROUNDS);
+        }
+    }
+
+    // Layout of the gains before GainTransactions, four strings per trade in a map by ISIN
+    struct StringTrade {
+        std::string mDate;
+        std::string mType;
+        std::string mIsin;
+        std::string mIsinName;
+        double mQuantity {0.0};
+        double mUnitPrice {0.0};
+    };
+
+    // Storing the gains of a large portfolio, grouping them by ISIN and date and walking every security's trades
+    void benchmarkGainStore() {
+        std::vector<std::string> isins;
+        std::vector<std::string> names;
+        for (size_t security = 0; security < PORTFOLIO_SECURITIES; ++security) {
+            char isin[16];
+            std::snprintf(isin, sizeof(isin), "IE%010zu", security * 7919);
+            isins.emplace_back(isin);
+            names.push_back("Savings Plan UCITS ETF " + std::to_string(security));
+        }
+        std::vector<std::int32_t> days;
+        std::vector<std::string> dates;
+        for (size_t trade = 0; trade < PORTFOLIO_TRADES; ++trade) {
+            const std::chrono::sys_days day {std::chrono::days {19'000 + static_cast<int>(trade / 8)}};
+            const std::chrono::year_month_day ymd {day};
+            char date[16];
+            std::snprintf(date, sizeof(date), "%04d-%02u-%02u", static_cast<int>(ymd.year()), static_cast<unsigned>(ymd.month()),
+                          static_cast<unsigned>(ymd.day()));
+            days.push_back(static_cast<std::int32_t>(day.time_since_epoch().count()));
+            dates.emplace_back(date);
+        }
+
+        report("gains, map of string records", PORTFOLIO_TRADES, "trades", [&] {
+            std::map<std::string, std::vector<StringTrade>> gains;
+            for (size_t trade = 0; trade < PORTFOLIO_TRADES; ++trade) {
+                const auto security = trade % PORTFOLIO_SECURITIES;
+                gains[isins[security]].push_back({dates[trade], "Trading Buy", isins[security], names[security], 1.0, 10.0});
+            }
+            for (auto& [isin, trades] : gains) {
+                std::sort(trades.begin(), trades.end(), [](const StringTrade& a, const StringTrade& b) { return a.mDate < b.mDate; });
+                for (const auto& trade : trades) {
+                    gSink += static_cast<size_t>(trade.mQuantity) + trade.mDate.size();
+                }
+            }
+        }, TEXT_ROUNDS);
+        report("gains, GainTransactions columns", PORTFOLIO_TRADES, "trades", [&] {
+            GainTransactions gains;
+            for (size_t trade = 0; trade < PORTFOLIO_TRADES; ++trade) {
+                const auto security = trade % PORTFOLIO_SECURITIES;
+                gains.add(isins[security], names[security], days[trade], TradeType::Buy, 1.0, 10.0);
+            }
+            gains.sort();
+            const auto quantities = gains.quantities();
+            for (GainTransactions::Security security = 0; security < gains.securityCount(); ++security) {
+                for (const auto trade : gains.rows(security)) {
+                    gSink += static_cast<size_t>(quantities[trade]) + static_cast<size_t>(gains.days()[trade] & 1);
+                }
+            }
+        }, TEXT_ROUNDS);
+
+        // Heap blocks of the names are counted at their length, the allocator adds its own overhead on top
+        const auto nameBytes = names.front().size() + 1;
+        std::cout << "bytes per trade: map of string records " << sizeof(StringTrade) + nameBytes << ", GainTransactions "
+                  << sizeof(std::int32_t) + sizeof(GainTransactions::Security) + sizeof(TradeType) + 2 * sizeof(double) << '\n';
+
+        GainTransactions gains;
+        for (size_t trade = 0; trade < PORTFOLIO_TRADES; ++trade) {
+            const auto security = trade % PORTFOLIO_SECURITIES;
+            gains.add(isins[security], names[security], days[trade], TradeType::Buy, 1.0, 10.0);
+        }
+        FormData form;
+        std::vector<unsigned> threadCounts {1};
+        if (std::thread::hardware_concurrency() > 1) {
+            threadCounts.push_back(std::thread::hardware_concurrency());
+        }
+        for (const auto threadCount : threadCounts) {
+            report("kdvp, prepare_kdvp_data on " + std::to_string(threadCount) + " thread(s)", PORTFOLIO_TRADES, "trades", [&] {
+                gSink += XmlGenerator::prepare_kdvp_data(gains, form, threadCount).mItems.size();
+            }, TEXT_ROUNDS);
+        }
+    }
+
+    void benchmarkLotMatching() {
+        // Every third trade sells, so sales keep splitting the lots of the buys before them
+        GainTransactions trades;
+        for (size_t trade = 0; trade < MICRO_TRADES; ++trade) {
+            const auto coin = "XC00000000" + std::to_string(trade % MICRO_SECURITIES);
+            const auto day = static_cast<std::int32_t>(19'000 + trade / 1'000);
+            const auto type = trade % 3 == 2 ? TradeType::Sell : TradeType::Buy;
+            const auto quantity = 0.0001 * static_cast<double>(1 + trade % 7);
+            trades.add(coin, "Coin", day, type, quantity, 20'000.0 + static_cast<double>(trade % 1'000));
+        }
+        trades.sort();
+
+        report("lots, LotMatcher::fifo", MICRO_TRADES, "trades", [&] {
+            const auto lots = LotMatcher::fifo(trades);
+            gSink += lots.matches().size() + lots.unmatched().size();
+        }, TEXT_ROUNDS);
+    }
+}
+
+int main() {
+    const auto lines = trimmedReportLines();
+    if (lines.empty()) {
+        std::cerr << "Test data missing: " << txtPdfData << '\n';
+        return 1;
+    }
+    std::cout << lines.size() << " non-empty lines, " << ROUNDS << " rounds\n";
+
+    using namespace report_lines;
+    benchmarkGainsRegexChain(lines);
+    benchmarkClassifier<GainsLines>("gains", lines);
+    benchmarkClassifier<IncomeLines>("income", lines);
+    benchmarkClassifier<WithholdingLines>("withholding", lines);
+    benchmarkClassifier<HistoryLines>("history", lines);
+
+    const auto numberTokens = reportNumbers(lines);
+    std::cout << numberTokens.size() << " number tokens\n";
+    benchmarkNumbers(numberTokens);
+
+    const auto dates = reportDates(lines);
+    std::cout << dates.size() << " dates\n";
+    benchmarkDates(dates);
+
+    const auto text = syntheticReport();
+    std::cout << text.size() / (1024 * 1024) << " MB synthetic report, " << TEXT_ROUNDS << " rounds\n";
+    benchmarkLineSplitting(text);
+
+    std::cout << PORTFOLIO_TRADES << " trades in " << PORTFOLIO_SECURITIES << " securities, " << TEXT_ROUNDS << " rounds\n";
+    benchmarkGainStore();
+
+    std::cout << MICRO_TRADES << " micro-trades in " << MICRO_SECURITIES << " securities, " << TEXT_ROUNDS << " rounds\n";
+    benchmarkLotMatching();
+
+    std::cout << "checksum " << gSink << '\n';
+    return 0;
+}
@@ -73,6 +73,33 @@ TEST_F(ApplicationServiceApiTest, ShouldGenerateFullXml) {
     EXPECT_TRUE(fs::exists(m_testOutputDir / "Doh_KDVP.xml"));
 }
 
+TEST_F(ApplicationServiceApiTest, SpilledTextRemovedAfterRequest) {
+    ReportLoader loader;
+    loader.setRawText(m_rawTextContent, ReportLoader::ProcessingMode::FileBased);
+    const auto spillFile = loader.tempFilePath();
+    ASSERT_TRUE(fs::exists(spillFile));
+
+    ApplicationService service;
+    GenerationRequest request;
+    request.outputDirectory = m_testOutputDir;
+    request.inputFile = m_mockTxtPath;
+    request.taxNumber = "12345678";
+    request.year = 2024;
+    request.formType = TaxFormType::Doh_KDVP;
+
+    auto result = service.processRequest(request, loader);
+    ASSERT_TRUE(result.success) << "Error: " << result.message;
+    EXPECT_FALSE(fs::exists(spillFile));
+
+    // A request failing after the text was extracted removes it as well
+    loader.setRawText(m_rawTextContent, ReportLoader::ProcessingMode::FileBased);
+    const auto failedSpillFile = loader.tempFilePath();
+    request.grammarFile = m_testOutputDir / "missing_grammar.json";
+    result = service.processRequest(request, loader);
+    ASSERT_FALSE(result.success);
+    EXPECT_FALSE(fs::exists(failedSpillFile));
+}
+
 TEST_F(ApplicationServiceApiTest, UnsupportedExtension) {
     // Create a dummy file with unsupported extension
     fs::path badFile = m_testOutputDir / "dummy.bin";
@@ -182,6 +209,27 @@ TEST_F(ApplicationServiceApiTest, JsonInput_JsonOnly) {
     EXPECT_TRUE(fs::exists(m_testOutputDir / "Doh_KDVP.xml"));
 }
 
+TEST_F(ApplicationServiceApiTest, JsonInput_FromMemoryBuffer) {
+    fs::path jsonFile = m_root / "tests" / "testData" / "expected_test_output.json";
+    std::ifstream ifs(jsonFile);
+    const std::string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    ASSERT_FALSE(content.empty());
+
+    // Only the extension of the name matters, the file itself does not exist
+    ApplicationService service;
+    GenerationRequest request;
+    request.outputDirectory = m_testOutputDir;
+    request.inputFile = m_testOutputDir / "upload.json";
+    request.inputData = std::as_bytes(std::span(content));
+    request.formType = TaxFormType::Doh_KDVP;
+    request.taxNumber = "999";
+    request.year = 2024;
+
+    auto result = service.processRequest(request);
+    ASSERT_TRUE(result.success) << "Error: " << result.message;
+    EXPECT_TRUE(fs::exists(m_testOutputDir / "Doh_KDVP.xml"));
+}
+
 #if TEST_ALL_API
 
 class ApplicationApiTest : public ApplicationServiceApiTest {
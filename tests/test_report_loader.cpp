@@ -1,4 +1,15 @@
 #include <report_loader.hpp>
+#include <extraction_cache.hpp>
+#include <mapped_file.hpp>
+#include <raw_text_arena.hpp>
+#include <line_cursor.hpp>
+#include <bounded_queue.hpp>
+#include <cell_layout.hpp>
+#include <line_index.hpp>
+#include <number_parser.hpp>
+#include <report_lines.hpp>
+#include <report_grammar.hpp>
+#include <xml_generator.hpp>
 #include <gtest/gtest.h>
 #include <nlohmann/json.hpp>
 #include <filesystem>
@@ -6,6 +17,14 @@
 #include <stdexcept>
 #include <iostream>
 #include <regex>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <thread>
+#include <latch>
+#include <set>
+#include <atomic>
 
 // Define paths for the input PDF and the output JSON file
 const std::filesystem::path projectRoot {PROJECT_SOURCE_DIR};
@@ -40,6 +59,19 @@ class TestReportLoader : public ReportLoader {
         }
 };
 
+// Pages of the pre-extracted text, each ending with the '\f' of page::text() like the loader gets them from poppler
+std::vector<std::string> fixturePages() {
+    std::ifstream txtFile(txtPdfData);
+    const std::string text((std::istreambuf_iterator<char>(txtFile)), std::istreambuf_iterator<char>());
+    std::vector<std::string> pages;
+    for (size_t start = 0; start < text.size();) {
+        const auto end = std::min(text.find('\f', start), text.size());
+        pages.push_back(text.substr(start, end - start + 1));
+        start = end + 2; // The loader puts a newline after every page
+    }
+    return pages;
+}
+
 TEST(ReportLoaderTest, GetRawPdfData_InMemory) {
     ASSERT_TRUE(std::filesystem::exists(expectedJson)) << "Expected JSON file does not exist: " << expectedJson;
     ASSERT_TRUE(std::filesystem::exists(txtPdfData)) << "PDF TXT file does not exist: " << txtPdfData;
@@ -130,6 +162,1067 @@ TEST(ReportLoaderTest, GetRawPdfData_InMemoryModeStoresInMemory) {
     loader.clearRawText();
 }
 
+TEST(ReportLoaderTest, GetRawPdfData_ParallelMatchesSequential) {
+    if (!std::filesystem::exists(pdfPath)) {
+        GTEST_SKIP() << "Input PDF file does not exist: " << pdfPath;
+    }
+
+    ReportLoader sequentialLoader;
+    sequentialLoader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::InMemory);
+    const auto expectedJson = sequentialLoader.convertToJson();
+
+    // Odd counts and more threads than pages exercise the uneven range split
+    for (const unsigned threads : {1u, 2u, 3u, 7u, 64u}) {
+        ReportLoader parallelLoader;
+        parallelLoader.setThreadCount(threads);
+        parallelLoader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::Parallel);
+
+        ASSERT_EQ(sequentialLoader.getRawText(), parallelLoader.getRawText()) << "Raw text differs with " << threads << " threads";
+        ASSERT_EQ(expectedJson, parallelLoader.convertToJson()) << "Parsed JSON differs with " << threads << " threads";
+        parallelLoader.clearRawText();
+    }
+}
+
+TEST(ReportLoaderTest, GetRawPdfData_ParallelInvalidPath) {
+    ReportLoader loader;
+    loader.setThreadCount(4);
+
+    EXPECT_THROW({
+        loader.getRawPdfData("/nonexistent/path/to/invalid.pdf", ReportLoader::ProcessingMode::Parallel);
+    }, std::runtime_error) << "Should throw exception for invalid PDF path";
+}
+
+TEST(ReportLoaderTest, GetRawPdfData_StreamingMatchesInMemory) {
+    if (!std::filesystem::exists(pdfPath)) {
+        GTEST_SKIP() << "Input PDF file does not exist: " << pdfPath;
+    }
+
+    ReportLoader inMemoryLoader;
+    inMemoryLoader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::InMemory);
+    const auto expectedJson = inMemoryLoader.convertToJson();
+
+    // Gains and history sections span several pages, so this also covers context stitching over page breaks
+    ReportLoader streamingLoader;
+    streamingLoader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::Streaming);
+    ASSERT_TRUE(streamingLoader.getRawText().empty()) << "Streaming mode should not keep the whole raw text";
+    ASSERT_EQ(expectedJson, streamingLoader.convertToJson());
+
+    streamingLoader.clearRawText();
+    EXPECT_THROW({
+        streamingLoader.convertToJson();
+    }, std::runtime_error) << "Should throw after clearRawText releases the document";
+}
+
+TEST(ReportLoaderTest, BoundedQueue_PushWaitsForRoom) {
+    BoundedQueue<int> queue {2};
+    ASSERT_TRUE(queue.push(1));
+    ASSERT_TRUE(queue.push(2));
+
+    std::atomic<bool> pushed {false};
+    std::thread producer {[&] {
+        pushed = queue.push(3);
+    }};
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_FALSE(pushed) << "push() must wait while the queue is full";
+
+    ASSERT_EQ(queue.pop(), 1);
+    producer.join();
+    ASSERT_TRUE(pushed);
+    ASSERT_EQ(queue.pop(), 2);
+    ASSERT_EQ(queue.pop(), 3);
+}
+
+TEST(ReportLoaderTest, BoundedQueue_CloseDrainsThenEnds) {
+    BoundedQueue<int> queue {4};
+    ASSERT_TRUE(queue.push(1));
+    ASSERT_TRUE(queue.push(2));
+    queue.close();
+    ASSERT_FALSE(queue.push(3));
+
+    ASSERT_EQ(queue.pop(), 1);
+    ASSERT_EQ(queue.pop(), 2);
+    ASSERT_EQ(queue.pop(), std::nullopt);
+    ASSERT_EQ(queue.pop(), std::nullopt);
+
+    // Closing wakes a producer waiting for room and a consumer waiting for an item
+    BoundedQueue<int> full {1};
+    ASSERT_TRUE(full.push(1));
+    std::optional<bool> pushed;
+    std::thread producer {[&] { pushed = full.push(2); }};
+    BoundedQueue<int> empty {1};
+    std::optional<int> popped {0};
+    std::thread consumer {[&] { popped = empty.pop(); }};
+    full.close();
+    empty.close();
+    producer.join();
+    consumer.join();
+    ASSERT_EQ(pushed, false);
+    ASSERT_EQ(popped, std::nullopt);
+}
+
+TEST(ReportLoaderTest, Streaming_RawPagesMatchInMemory) {
+    const auto pages = fixturePages();
+    ReportLoader memoryLoader;
+    memoryLoader.setRawPages(pages);
+
+    // More pages than the queue holds, so the producer waits for the parser
+    ReportLoader streamingLoader;
+    streamingLoader.setRawPages(pages, ReportLoader::ProcessingMode::Streaming);
+    ASSERT_TRUE(streamingLoader.getRawText().empty());
+    ASSERT_EQ(streamingLoader.convertToJson(), memoryLoader.convertToJson());
+    ASSERT_EQ(streamingLoader.strippedBytes(), memoryLoader.strippedBytes());
+}
+
+TEST(ReportLoaderTest, Streaming_ParserStopsEarly) {
+    const auto pages = fixturePages();
+
+    // The producer is left waiting in push() on a full queue, returning must still join it
+    ReportLoader stoppingLoader;
+    stoppingLoader.setRawPages(pages, ReportLoader::ProcessingMode::Streaming);
+    size_t lines {0};
+    stoppingLoader.consumeStream([&](LineCursor& aCursor) {
+        while (lines < 5 && aCursor.next()) {
+            ++lines;
+        }
+    });
+    ASSERT_EQ(lines, 5);
+
+    // A throwing parser shuts the producer down the same way and its error reaches the caller
+    ReportLoader throwingLoader;
+    throwingLoader.setRawPages(pages, ReportLoader::ProcessingMode::Streaming);
+    ASSERT_THROW(throwingLoader.consumeStream([](LineCursor& aCursor) {
+        aCursor.next();
+        throw std::invalid_argument {"Parser failed"};
+    }), std::invalid_argument);
+}
+
+TEST(ReportLoaderTest, GetRawPdfData_FileBasedMatchesInMemory) {
+    if (!std::filesystem::exists(pdfPath)) {
+        GTEST_SKIP() << "Input PDF file does not exist: " << pdfPath;
+    }
+
+    ReportLoader memoryLoader;
+    memoryLoader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::InMemory);
+
+    // FileBased parses through a memory mapping of the temporary file
+    ReportLoader fileLoader;
+    fileLoader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::FileBased);
+    ASSERT_EQ(memoryLoader.convertToJson(), fileLoader.convertToJson());
+    fileLoader.clearRawText();
+}
+
+TEST(ReportLoaderTest, FileBased_TempFileRemoved) {
+    std::ifstream txtFile(txtPdfData);
+    const std::string text((std::istreambuf_iterator<char>(txtFile)), std::istreambuf_iterator<char>());
+    ASSERT_FALSE(text.empty());
+
+    std::filesystem::path replaced;
+    std::filesystem::path cleared;
+    std::filesystem::path destroyed;
+    {
+        ReportLoader memoryLoader;
+        memoryLoader.setRawText(text);
+
+        ReportLoader fileLoader;
+        fileLoader.setRawText(text, ReportLoader::ProcessingMode::FileBased);
+        replaced = fileLoader.tempFilePath();
+        fileLoader.setRawText(text, ReportLoader::ProcessingMode::FileBased);
+        ASSERT_FALSE(std::filesystem::exists(replaced)) << "A new temporary file replaces the old one";
+        cleared = fileLoader.tempFilePath();
+        ASSERT_TRUE(std::filesystem::exists(cleared));
+        ASSERT_EQ(fileLoader.processingMode(), ReportLoader::ProcessingMode::FileBased);
+        ASSERT_EQ(fileLoader.convertToJson(), memoryLoader.convertToJson());
+        fileLoader.clearRawText();
+        ASSERT_FALSE(std::filesystem::exists(cleared));
+        ASSERT_TRUE(fileLoader.tempFilePath().empty());
+
+        ReportLoader abandonedLoader;
+        abandonedLoader.setRawText(text, ReportLoader::ProcessingMode::FileBased);
+        destroyed = abandonedLoader.tempFilePath();
+        ASSERT_TRUE(std::filesystem::exists(destroyed));
+    }
+    ASSERT_FALSE(std::filesystem::exists(destroyed)) << "The loader deletes its temporary file when it goes away";
+}
+
+TEST(ReportLoaderTest, ConcurrentLoaders_ProduceIdenticalOutput) {
+    constexpr size_t LOADERS = 64;
+    const ReportLoader::ProcessingMode modes[] {ReportLoader::ProcessingMode::InMemory, ReportLoader::ProcessingMode::FileBased,
+                                                ReportLoader::ProcessingMode::Parallel, ReportLoader::ProcessingMode::Streaming};
+
+    TestReportLoader referenceLoader;
+    referenceLoader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::InMemory);
+    const auto expected = referenceLoader.convertToJson().dump();
+
+    // All loaders start together, so FileBased loaders create their temporary files at the same moment
+    std::vector<std::string> outputs(LOADERS);
+    std::vector<std::string> errors(LOADERS);
+    std::latch start {LOADERS};
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < LOADERS; ++i) {
+        threads.emplace_back([&, i] {
+            try {
+                TestReportLoader loader;
+                loader.setThreadCount(2);
+                loader.setParallelSections(i % 8 >= 4);
+                start.arrive_and_wait();
+                loader.getRawPdfData(pdfPath.string(), modes[i % std::size(modes)]);
+                outputs[i] = loader.convertToJson().dump();
+                loader.clearRawText();
+            } catch (const std::exception& e) {
+                errors[i] = e.what();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < LOADERS; ++i) {
+        ASSERT_EQ(errors[i], "") << "Loader " << i;
+        ASSERT_EQ(outputs[i], expected) << "Loader " << i;
+    }
+}
+
+TEST(ReportLoaderTest, ConcurrentFileBasedSpills_UseDistinctFiles) {
+    constexpr size_t LOADERS = 64;
+    std::ifstream txtFile(txtPdfData);
+    const std::string text((std::istreambuf_iterator<char>(txtFile)), std::istreambuf_iterator<char>());
+    ASSERT_FALSE(text.empty());
+
+    ReportLoader referenceLoader;
+    referenceLoader.setRawText(text);
+    const auto expected = referenceLoader.convertToJson().dump();
+
+    // All loaders spill at the same moment and keep their files until every one has been parsed
+    std::vector<std::filesystem::path> paths(LOADERS);
+    std::vector<std::string> outputs(LOADERS);
+    std::vector<std::string> errors(LOADERS);
+    std::latch start {LOADERS};
+    std::latch parsed {LOADERS};
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < LOADERS; ++i) {
+        threads.emplace_back([&, i] {
+            try {
+                ReportLoader loader;
+                start.arrive_and_wait();
+                loader.setRawText(text, ReportLoader::ProcessingMode::FileBased);
+                paths[i] = loader.tempFilePath();
+                outputs[i] = loader.convertToJson().dump();
+                parsed.arrive_and_wait();
+            } catch (const std::exception& e) {
+                errors[i] = e.what();
+                parsed.count_down();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < LOADERS; ++i) {
+        ASSERT_EQ(errors[i], "") << "Loader " << i;
+        ASSERT_FALSE(paths[i].empty()) << "Loader " << i;
+        ASSERT_EQ(outputs[i], expected) << "Loader " << i;
+        ASSERT_FALSE(std::filesystem::exists(paths[i])) << "Loader " << i;
+    }
+    std::sort(paths.begin(), paths.end());
+    ASSERT_EQ(std::adjacent_find(paths.begin(), paths.end()), paths.end()) << "Two loaders spilled into the same file";
+}
+
+TEST(ReportLoaderTest, GetRawPdfData_MemoryBufferMatchesPath) {
+    if (!std::filesystem::exists(pdfPath)) {
+        GTEST_SKIP() << "Input PDF file does not exist: " << pdfPath;
+    }
+
+    std::ifstream pdfFile(pdfPath, std::ios::binary);
+    const std::string pdfBytes((std::istreambuf_iterator<char>(pdfFile)), std::istreambuf_iterator<char>());
+
+    ReportLoader pathLoader;
+    pathLoader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::InMemory);
+
+    for (const auto mode : {ReportLoader::ProcessingMode::InMemory, ReportLoader::ProcessingMode::Parallel}) {
+        ReportLoader bufferLoader;
+        bufferLoader.setThreadCount(3);
+        bufferLoader.getRawPdfData(std::as_bytes(std::span(pdfBytes)), mode);
+        ASSERT_EQ(pathLoader.getRawText(), bufferLoader.getRawText());
+    }
+
+    // Streaming reads the buffer while converting
+    ReportLoader streamLoader;
+    streamLoader.getRawPdfData(std::as_bytes(std::span(pdfBytes)), ReportLoader::ProcessingMode::Streaming);
+    ASSERT_EQ(pathLoader.convertToJson(), streamLoader.convertToJson());
+
+    ReportLoader emptyLoader;
+    ASSERT_THROW(emptyLoader.getRawPdfData(std::span<const std::byte> {}), std::runtime_error);
+}
+
+TEST(ReportLoaderTest, GetRawPdfData_AutoModeRespectsMemoryBudget) {
+    if (!std::filesystem::exists(pdfPath)) {
+        GTEST_SKIP() << "Input PDF file does not exist: " << pdfPath;
+    }
+
+    ReportLoader memoryLoader;
+    memoryLoader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::InMemory);
+    const auto expected = memoryLoader.convertToJson();
+
+    // Budgets in between may pick InMemory up front and spill to a file during extraction
+    for (const size_t budget : {size_t {1}, size_t {16 * 1024}, size_t {64 * 1024}, size_t {256 * 1024}, size_t {1} << 30}) {
+        ReportLoader loader;
+        loader.setMemoryBudget(budget);
+        loader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::Auto);
+
+        const auto mode = loader.processingMode();
+        ASSERT_TRUE(mode == ReportLoader::ProcessingMode::InMemory || mode == ReportLoader::ProcessingMode::FileBased);
+        if (mode == ReportLoader::ProcessingMode::InMemory) {
+            ASSERT_LE(loader.getRawText().size(), budget);
+        }
+        ASSERT_EQ(expected, loader.convertToJson()) << "Budget " << budget;
+        loader.clearRawText();
+    }
+
+    ReportLoader tightLoader;
+    tightLoader.setMemoryBudget(1);
+    tightLoader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::Auto);
+    ASSERT_EQ(tightLoader.processingMode(), ReportLoader::ProcessingMode::FileBased);
+    tightLoader.clearRawText();
+
+    ReportLoader roomyLoader;
+    roomyLoader.setMemoryBudget(size_t {1} << 30);
+    roomyLoader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::Auto);
+    ASSERT_EQ(roomyLoader.processingMode(), ReportLoader::ProcessingMode::InMemory);
+}
+
+TEST(ReportLoaderTest, AutoMode_CountsResidentInputAgainstBudget) {
+    const auto pages = fixturePages();
+    ASSERT_EQ(pages.size(), 24);
+    ReportLoader memoryLoader;
+    memoryLoader.setRawPages(pages);
+    const auto text = std::string {memoryLoader.getRawText()};
+    const auto expected = memoryLoader.convertToJson();
+    constexpr size_t ESTIMATED_BYTES = 24 * 1024;
+    ASSERT_GT(text.size(), ESTIMATED_BYTES) << "The estimate must pick InMemory for the text to spill";
+
+    // The text alone fits, the caller's buffer next to it does not: InMemory is chosen and spills during extraction
+    const size_t budget = text.size() + 1024;
+    const size_t residentInput = budget - ESTIMATED_BYTES;
+    ReportLoader spillingLoader;
+    spillingLoader.setMemoryBudget(budget);
+    spillingLoader.setRawPages(pages, ReportLoader::ProcessingMode::Auto, residentInput);
+    ASSERT_EQ(spillingLoader.processingMode(), ReportLoader::ProcessingMode::FileBased);
+    ASSERT_TRUE(spillingLoader.getRawText().empty());
+    ASSERT_TRUE(std::filesystem::exists(spillingLoader.tempFilePath()));
+    ASSERT_EQ(std::filesystem::file_size(spillingLoader.tempFilePath()), text.size());
+    ASSERT_EQ(spillingLoader.convertToJson(), expected);
+    const auto spilled = spillingLoader.tempFilePath();
+    spillingLoader.clearRawText();
+    ASSERT_FALSE(std::filesystem::exists(spilled));
+
+    // Without the buffer the same budget keeps the text in memory
+    ReportLoader roomyLoader;
+    roomyLoader.setMemoryBudget(budget);
+    roomyLoader.setRawPages(pages, ReportLoader::ProcessingMode::Auto);
+    ASSERT_EQ(roomyLoader.processingMode(), ReportLoader::ProcessingMode::InMemory);
+    ASSERT_EQ(roomyLoader.getRawText(), text);
+
+    // A buffer beyond the budget goes to a file up front
+    ReportLoader tightLoader;
+    tightLoader.setMemoryBudget(budget);
+    tightLoader.setRawPages(pages, ReportLoader::ProcessingMode::Auto, budget);
+    ASSERT_EQ(tightLoader.processingMode(), ReportLoader::ProcessingMode::FileBased);
+    ASSERT_EQ(tightLoader.convertToJson(), expected);
+}
+
+TEST(ReportLoaderTest, GetRawPdfData_CellsLayoutMatchesFlat) {
+    if (!std::filesystem::exists(pdfPath)) {
+        GTEST_SKIP() << "Input PDF file does not exist: " << pdfPath;
+    }
+
+    ReportLoader flatLoader;
+    flatLoader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::InMemory);
+    const auto expected = flatLoader.convertToJson();
+
+    ReportLoader cellsLoader;
+    cellsLoader.setTextLayout(ReportLoader::TextLayout::Cells);
+    cellsLoader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::InMemory);
+    ASSERT_NE(cellsLoader.getRawText().find('\t'), std::string::npos) << "Table rows should be split into cells";
+    ASSERT_EQ(expected, cellsLoader.convertToJson());
+}
+
+TEST(ReportLoaderTest, CellLayout_ValidatesCells) {
+    using namespace cell_layout;
+    ASSERT_TRUE(splitCells("Trading Buy 10.03.2025 100").empty()) << "Flat text has no cells";
+    ASSERT_EQ(splitCells("EUR\t1.00\t\t2"), (std::vector<std::string_view> {"EUR", "1.00", "", "2"}));
+
+    ASSERT_TRUE(isDate("10.03.2025"));
+    ASSERT_FALSE(isDate(".........."));
+    ASSERT_FALSE(isDate("1.03.2025"));
+    ASSERT_FALSE(isDate("10-03-2025"));
+    ASSERT_FALSE(isDate("10.03.2025 1"));
+
+    for (const auto number : {"0", "999", "1,000", "-12,345,678", "1,234.5678", "-0.5"}) {
+        ASSERT_TRUE(isGroupedNumber(number)) << number;
+    }
+    for (const auto number : {"", "-", "1234", "1,23", "1,2345", ",123", "1.", ".5", "1.2.3", "1 000", "--1"}) {
+        ASSERT_FALSE(isGroupedNumber(number)) << number;
+    }
+
+    ASSERT_TRUE(isLooseNumber("1234,5.6", false));
+    ASSERT_TRUE(isLooseNumber("-10.00", true));
+    ASSERT_FALSE(isLooseNumber("-10.00", false));
+    ASSERT_FALSE(isLooseNumber("-", true));
+    ASSERT_FALSE(isLooseNumber("", false));
+    ASSERT_FALSE(isLooseNumber("12%", false));
+}
+
+TEST(ReportLoaderTest, CellLayout_LaysOutWords) {
+    using cell_layout::Word;
+    // 10 units line height and pitch, characters 2 units wide, so a gap of 3 units or more starts a cell
+    const auto word = [](std::string aText, double aLeft, double aLine) {
+        const auto width = 2.0 * static_cast<double>(aText.size());
+        return Word {std::move(aText), aLeft, aLeft + width, aLine * 10.0 + 5.0, 8.0, 2.0};
+    };
+
+    // Given out of order, with a blank line between the rows
+    const std::string text = cell_layout::layoutPage({
+        word("10.03.2025", 40.0, 3.0), word("Buy", 16.0, 0.0), word("Trading", 0.0, 0.0), word("10.03.2025", 40.0, 0.0),
+        word("1,100", 64.0, 0.0), word("EUR", 0.0, 1.0), word("9.99", 20.0, 1.0), word("Trading", 0.0, 3.0),
+        word("Sell", 15.0, 3.0), word("1,100", 61.0, 3.0), word("EUR", 0.0, 4.0), word("1.00", 20.0, 4.0),
+    });
+    // "Trading Buy" stays one cell, the second date and amount are only one unit apart and merge into one cell
+    ASSERT_EQ(text, "Trading Buy\t10.03.2025\t1,100\nEUR\t9.99\n\nTrading Sell\t10.03.2025 1,100\nEUR\t1.00\n\f");
+    ASSERT_EQ(cell_layout::layoutPage({}), "\f");
+}
+
+TEST(ReportLoaderTest, CellsText_ParsesLikeFlatText) {
+    const auto report = [](char aSeparator, const std::string& aMergedRow) {
+        const auto line = [aSeparator](std::initializer_list<std::string_view> aCells) {
+            std::string text;
+            for (const auto cell : aCells) {
+                text += text.empty() ? "" : std::string(1, aSeparator);
+                text += cell;
+            }
+            return text + "\n";
+        };
+        std::string data;
+        data += "VI. Detailed Gains and Losses Section\n";
+        data += line({"Transaction", "Date", "Units", "Price"});
+        data += line({"Asset Type:", "Equities"});
+        data += line({"Country:", "GainsLand"});
+        data += line({"ZZ1111111111", "-", "Some Asset"});
+        data += line({"Trading Buy", "10.03.2025", "1,100", "1.2000"});
+        data += line({"EUR", "1,234.50", "0.00", "0.00", "0.00", "0.00", "9.99"});
+        data += aMergedRow;
+        data += line({"Trading Sell", "12.03.2025", "-12,345.5", "1.3000"});
+        data += line({"EUR", "13.34", "0.00", "0.00", "0.00", "0.00", "1.00"});
+        data += line({"Gains", "EUR", "1.00", "0.00", "0.00"});
+        data += "VIII. History of Transactions and Corporate Actions\n";
+        data += line({"Transaction", "Value Date", "Units"});
+        data += line({"ZZ1111111111", "-", "Some Asset"});
+        data += line({"Trading Buy", "01.01.2025", "02.01.2025", "EUR", "1,100.00", "10.00", "1000.00", "50.00"});
+        data += line({"Trading Sell", "03.01.2025", "04.01.2025", "EUR", "1.5", "-10.00", "1,000.00", "0.5"});
+        return data;
+    };
+
+    TestReportLoader flatLoader;
+    flatLoader.setRawText(report(' ', ""));
+    const auto expected = flatLoader.convertToJson();
+
+    // A row whose date and amount merged into one cell is not a transaction, where flat text would still match it
+    TestReportLoader cellsLoader;
+    cellsLoader.setRawText(report('\t', "Trading Buy\t11.03.2025 5\t1.0000\n"));
+    const auto actual = cellsLoader.convertToJson();
+    ASSERT_EQ(actual, expected);
+
+    const auto& gains = actual["gains_and_losses_section"];
+    ASSERT_EQ(gains.size(), 1);
+    ASSERT_EQ(gains[0]["asset_type"], "Equities");
+    ASSERT_EQ(gains[0]["country"], "GainsLand");
+    const auto& trades = gains[0]["transactions"];
+    ASSERT_EQ(trades.size(), 2);
+    ASSERT_EQ(trades[0]["isin"], "ZZ1111111111 - Some Asset");
+    ASSERT_EQ(trades[0]["amount_of_units"], 1100.0);
+    ASSERT_EQ(trades[0]["unit_price"], 1234.5);
+    ASSERT_EQ(trades[1]["transaction_date"], "12.03.2025");
+    ASSERT_EQ(trades[1]["amount_of_units"], 12345.5);
+
+    const auto& history = actual["transaction_history"];
+    ASSERT_EQ(history.size(), 1);
+    ASSERT_EQ(history[0]["transactions"].size(), 2);
+    ASSERT_EQ(history[0]["transactions"][1]["transaction_type"], "Trading Sell");
+    ASSERT_EQ(history[0]["transactions"][1]["exchange_rate"], 1.5);
+}
+
+TEST(ReportLoaderTest, GetRawPdfData_StripsRepeatedBoilerplate) {
+    if (!std::filesystem::exists(pdfPath)) {
+        GTEST_SKIP() << "Input PDF file does not exist: " << pdfPath;
+    }
+
+    ReportLoader plainLoader;
+    plainLoader.setStripBoilerplate(false);
+    plainLoader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::InMemory);
+    ASSERT_EQ(plainLoader.strippedBytes(), 0u);
+    const auto expected = plainLoader.convertToJson();
+
+    for (const auto mode : {ReportLoader::ProcessingMode::InMemory, ReportLoader::ProcessingMode::Parallel,
+                            ReportLoader::ProcessingMode::Streaming}) {
+        ReportLoader loader;
+        loader.setThreadCount(3);
+        loader.getRawPdfData(pdfPath.string(), mode);
+        const auto json = loader.convertToJson();
+        ASSERT_GT(loader.strippedBytes(), 0u) << "Page headers should repeat in the report";
+        ASSERT_EQ(expected, json);
+        if (mode != ReportLoader::ProcessingMode::Streaming) {
+            ASSERT_EQ(loader.getRawText().size() + loader.strippedBytes(), plainLoader.getRawText().size());
+        }
+    }
+
+    // The client number survives on the first page that carries it
+    ReportLoader loader;
+    loader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::InMemory);
+    ASSERT_EQ(expected["client"], loader.convertToJson()["client"]);
+}
+
+TEST(ReportLoaderTest, Boilerplate_KeepsDataRowsAtPageEdges) {
+    const std::string header = "Client:           0101010101\nPeriod:           01.01.2024 - 31.12.2024\n"
+                               "Currency:         EUR\nCountry:          Base Country\n";
+    const std::string row = "Trading Buy 10.03.2025 1 1.0000\n";
+    const std::string amount = "EUR 1.00 0.00 0.00 0.00 0.00 0.00\n";
+
+    // Every page starts with the same trade right under the header and all but the last end on its EUR line,
+    // there is no footer. Only the header is boilerplate
+    std::vector<std::string> bodies {
+        "VI. Detailed Gains and Losses Section\nTransaction Date Units Price\nAsset Type: Equities\nCountry: GainsLand\n"
+        "ZZ1111111111 - Some Asset\n" + row + amount,
+        row + amount,
+        row + amount,
+        row + amount + "Gains EUR 4.00 0.00 0.00\n",
+    };
+    std::vector<std::string> pages;
+    std::string expectedText;
+    for (size_t page = 0; page < bodies.size(); ++page) {
+        pages.push_back(header + bodies[page]);
+        expectedText += (page == 0 ? header : "") + bodies[page] + "\n";
+    }
+
+    ReportLoader loader;
+    loader.setRawPages(pages);
+    ASSERT_EQ(loader.strippedBytes(), 3 * header.size());
+    ASSERT_EQ(loader.getRawText(), expectedText);
+
+    const auto json = loader.convertToJson();
+    ASSERT_EQ(json["gains_and_losses_section"].size(), 1);
+    ASSERT_EQ(json["gains_and_losses_section"][0]["transactions"].size(), 4);
+    for (const auto& trade : json["gains_and_losses_section"][0]["transactions"]) {
+        ASSERT_EQ(trade["unit_price"], 1.0);
+    }
+}
+
+TEST(ReportLoaderTest, GetRawPdfData_TableOfContentSelectsPages) {
+    if (!std::filesystem::exists(pdfPath)) {
+        GTEST_SKIP() << "Input PDF file does not exist: " << pdfPath;
+    }
+
+    ReportLoader fullLoader;
+    fullLoader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::InMemory);
+    const auto fullJson = fullLoader.convertToJson();
+
+    for (const auto mode : {ReportLoader::ProcessingMode::InMemory, ReportLoader::ProcessingMode::Parallel, ReportLoader::ProcessingMode::Streaming}) {
+        ReportLoader gainsLoader;
+        gainsLoader.setRequiredSections({ReportLoader::ReportSection::GainsAndLosses});
+        gainsLoader.getRawPdfData(pdfPath.string(), mode);
+        if (mode != ReportLoader::ProcessingMode::Streaming) {
+            ASSERT_LT(gainsLoader.getRawText().size(), fullLoader.getRawText().size()) << "Selective extraction should skip pages";
+        }
+
+        const auto gainsJson = gainsLoader.convertToJson();
+        ASSERT_EQ(fullJson["client"], gainsJson["client"]);
+        ASSERT_EQ(fullJson["gains_and_losses_section"], gainsJson["gains_and_losses_section"]);
+        ASSERT_TRUE(gainsJson["income_section"].empty()) << "Sections that are not required should not be parsed";
+    }
+
+    ReportLoader incomeLoader;
+    incomeLoader.setRequiredSections({ReportLoader::ReportSection::Income});
+    incomeLoader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::InMemory);
+    const auto incomeJson = incomeLoader.convertToJson();
+    ASSERT_EQ(fullJson["income_section"], incomeJson["income_section"]);
+}
+
+TEST(ReportLoaderTest, GetRawPdfData_TableOfContentSelectsLastSections) {
+    if (!std::filesystem::exists(pdfPath)) {
+        GTEST_SKIP() << "Input PDF file does not exist: " << pdfPath;
+    }
+
+    ReportLoader fullLoader;
+    fullLoader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::InMemory);
+    const auto fullJson = fullLoader.convertToJson();
+
+    // History runs until the explanatory notes, withholding sits in between
+    ReportLoader loader;
+    loader.setRequiredSections({ReportLoader::ReportSection::WithholdingTax, ReportLoader::ReportSection::TransactionHistory});
+    loader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::FileBased);
+    const auto json = loader.convertToJson();
+    ASSERT_EQ(fullJson["withholding_tax_section"], json["withholding_tax_section"]);
+    ASSERT_EQ(fullJson["transaction_history"], json["transaction_history"]);
+    loader.clearRawText();
+}
+
+TEST(ReportLoaderTest, TableOfContent_SelectsRawPages) {
+    const auto pages = fixturePages();
+    ReportLoader fullLoader;
+    fullLoader.setRawPages(pages);
+    const auto fullJson = fullLoader.convertToJson();
+    ASSERT_EQ(fullLoader.selectedPages().size(), pages.size());
+
+    auto selected = [](const std::vector<std::string>& aPages, std::set<ReportLoader::ReportSection> aSections) {
+        ReportLoader loader;
+        loader.setRequiredSections(std::move(aSections));
+        loader.setRawPages(aPages);
+        return loader.selectedPages();
+    };
+    auto pageRange = [](std::vector<int> aPages, int aFirst, int aLast) {
+        for (int page = aFirst; page <= aLast; ++page) {
+            aPages.push_back(page);
+        }
+        return aPages;
+    };
+
+    // The TOC is on the third page, sections get a page of margin on both sides
+    ASSERT_EQ(selected(pages, {ReportLoader::ReportSection::GainsAndLosses}), pageRange({0, 1, 2}, 8, 15));
+    ASSERT_EQ(selected(pages, {ReportLoader::ReportSection::Income}), pageRange({0, 1, 2}, 6, 10));
+    ASSERT_EQ(selected(pages, {ReportLoader::ReportSection::WithholdingTax, ReportLoader::ReportSection::TransactionHistory}),
+              pageRange({0, 1, 2}, 13, 22));
+
+    ReportLoader gainsLoader;
+    gainsLoader.setRequiredSections({ReportLoader::ReportSection::GainsAndLosses});
+    gainsLoader.setRawPages(pages);
+    const auto gainsJson = gainsLoader.convertToJson();
+    ASSERT_EQ(fullJson["gains_and_losses_section"], gainsJson["gains_and_losses_section"]);
+    ASSERT_TRUE(gainsJson["income_section"].empty());
+
+    auto edited = [&](const std::string& aFrom, const std::string& aTo) {
+        auto copy = pages;
+        const auto at = copy[2].find(aFrom);
+        EXPECT_NE(at, std::string::npos) << aFrom;
+        copy[2].replace(at, aFrom.size(), aTo);
+        return copy;
+    };
+    const auto allPages = pageRange({}, 0, static_cast<int>(pages.size()) - 1);
+
+    // Without a TOC, without the section in it or with a section starting later than listed, every page is read
+    ASSERT_EQ(selected(edited("Table of Content", "Overview"), {ReportLoader::ReportSection::GainsAndLosses}), allPages);
+    ASSERT_EQ(selected(edited("Detailed Gains and Losses Section", "Detailed Other Section"), {ReportLoader::ReportSection::GainsAndLosses}),
+              allPages);
+    ASSERT_EQ(selected(edited("Section                                    10", "Section                                    12"),
+                       {ReportLoader::ReportSection::GainsAndLosses}),
+              allPages);
+    ASSERT_EQ(selected(edited("Section                                               8", "Section                                               6"),
+                       {ReportLoader::ReportSection::Income}),
+              pageRange({0, 1, 2}, 4, 10)) << "A range opening earlier is still trusted";
+}
+
+TEST(ReportLoaderTest, GetRawPdfData_ExtractionCacheReusesPages) {
+    if (!std::filesystem::exists(pdfPath)) {
+        GTEST_SKIP() << "Input PDF file does not exist: " << pdfPath;
+    }
+
+    const auto cacheDir = std::filesystem::temp_directory_path() / "edavki_extraction_cache_test";
+    std::filesystem::remove_all(cacheDir);
+    const auto cache = std::make_shared<const ExtractionCache>(cacheDir);
+
+    ReportLoader plainLoader;
+    plainLoader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::InMemory);
+
+    // First run fills the cache, the second one is served from it
+    for (int run = 0; run < 2; ++run) {
+        ReportLoader loader;
+        loader.setExtractionCache(cache);
+        loader.getRawPdfData(pdfPath.string(), ReportLoader::ProcessingMode::InMemory);
+        ASSERT_EQ(plainLoader.getRawText(), loader.getRawText()) << "Run " << run;
+    }
+
+    const MappedFile pdf {pdfPath};
+    ASSERT_TRUE(cache->loadPageCount(ExtractionCache::makeKey(pdf.view(), ReportLoader::EXTRACTOR_VERSION)).has_value());
+
+    std::filesystem::remove_all(cacheDir);
+}
+
+TEST(ReportLoaderTest, ExtractionCache_StoreLoadAndKeys) {
+    const auto cacheDir = std::filesystem::temp_directory_path() / "edavki_extraction_cache_keys";
+    std::filesystem::remove_all(cacheDir);
+    ExtractionCache cache {cacheDir};
+
+    const auto key = ExtractionCache::makeKey("%PDF-1.7 first", 1);
+    ASSERT_NE(key, ExtractionCache::makeKey("%PDF-1.7 other", 1));
+    ASSERT_NE(key, ExtractionCache::makeKey("%PDF-1.7 first", 2));
+    ASSERT_EQ(key, ExtractionCache::makeKey("%PDF-1.7 first", 1));
+
+    ASSERT_FALSE(cache.loadPageCount(key).has_value());
+    ASSERT_FALSE(cache.loadPage(key, 0).has_value());
+
+    cache.storePageCount(key, 3);
+    cache.storePage(key, 1, "page two\f");
+    ASSERT_EQ(cache.loadPageCount(key), 3);
+    ASSERT_EQ(cache.loadPage(key, 1), "page two\f");
+    ASSERT_FALSE(cache.loadPage(key, 0).has_value());
+
+    std::filesystem::remove_all(cacheDir);
+}
+
+TEST(ReportLoaderTest, ExtractionCache_TrimEvictsLeastRecentlyUsed) {
+    const auto cacheDir = std::filesystem::temp_directory_path() / "edavki_extraction_cache_trim";
+    std::filesystem::remove_all(cacheDir);
+    ExtractionCache cache {cacheDir, 3000};
+
+    const std::string page(1000, 'x');
+    for (const auto* name : {"old", "new"}) {
+        cache.storePageCount(name, 1);
+        cache.storePage(name, 0, page);
+    }
+    std::filesystem::last_write_time(cacheDir / "old" / "meta", std::filesystem::file_time_type::clock::now() - std::chrono::hours {1});
+    cache.trim();
+    ASSERT_TRUE(cache.loadPage("old", 0).has_value()) << "Cache under the cap must not be trimmed";
+
+    cache.storePageCount("newest", 1);
+    cache.storePage("newest", 0, page);
+    cache.trim();
+    ASSERT_FALSE(cache.loadPage("old", 0).has_value());
+    ASSERT_TRUE(cache.loadPage("new", 0).has_value());
+    ASSERT_TRUE(cache.loadPage("newest", 0).has_value());
+
+    std::filesystem::remove_all(cacheDir);
+}
+
+TEST(ReportLoaderTest, RawTextArena_IndexesPages) {
+    RawTextArena arena;
+    arena.appendPage(0, "first\f");
+    arena.appendPage(2, "");
+    arena.appendPage(5, "third page\f");
+
+    ASSERT_EQ(arena.view(), "first\f\n\nthird page\f\n");
+    ASSERT_EQ(arena.pages().size(), 3u);
+    ASSERT_EQ(arena.page(0), "first\f");
+    ASSERT_EQ(arena.page(1), "");
+    ASSERT_EQ(arena.page(2), "third page\f");
+    ASSERT_EQ(arena.pages()[2].mPage, 5);
+    ASSERT_EQ(arena.pages()[2].mOffset, 8u);
+
+    arena.release();
+    ASSERT_TRUE(arena.empty());
+    ASSERT_TRUE(arena.pages().empty());
+}
+
+TEST(ReportLoaderTest, LineCursor_NavigatesBuffer) {
+    LineCursor cursor {"1: Client:  X \n\n\tV. Section\r\nlast"};
+
+    auto line = cursor.next();
+    ASSERT_TRUE(line);
+    ASSERT_EQ(line->mRaw, "Client:  X ");
+    ASSERT_EQ(line->mText, "Client:  X");
+    ASSERT_EQ(cursor.peek()->mText, "");
+    ASSERT_EQ(cursor.lookahead(2)->mText, "V. Section");
+    ASSERT_EQ(cursor.lookahead(3)->mText, "last");
+    ASSERT_FALSE(cursor.lookahead(4));
+    ASSERT_FALSE(cursor.lookbehind(2));
+
+    cursor.next();
+    ASSERT_EQ(cursor.next()->mText, "V. Section");
+    ASSERT_EQ(cursor.lookbehind(1)->mText, "V. Section");
+    ASSERT_EQ(cursor.lookbehind(3)->mText, "Client:  X");
+
+    ASSERT_TRUE(cursor.unread());
+    ASSERT_EQ(cursor.next()->mRaw, "\tV. Section\r");
+    ASSERT_EQ(cursor.next()->mText, "last");
+    ASSERT_FALSE(cursor.next());
+    ASSERT_FALSE(cursor.peek());
+
+    ASSERT_TRUE(cursor.unread());
+    ASSERT_EQ(cursor.next()->mText, "last");
+}
+
+TEST(ReportLoaderTest, LineCursor_PagedSourceKeepsWindow) {
+    std::vector<std::string> pages {"a1\na2\n", "b1\n", "c1\nc2\n"};
+    size_t pulled {0};
+    LineCursor cursor {[&]() -> std::optional<std::string> {
+        if (pulled == pages.size()) {
+            return std::nullopt;
+        }
+        return pages[pulled++];
+    }, 2};
+
+    ASSERT_EQ(cursor.next()->mText, "a1");
+    ASSERT_EQ(pulled, 1u);
+    ASSERT_EQ(cursor.next()->mText, "a2");
+    ASSERT_EQ(cursor.peek()->mText, "b1");
+    ASSERT_EQ(cursor.lookahead(2)->mText, "c1");
+    ASSERT_EQ(pulled, 3u);
+
+    // Step back over the page break
+    ASSERT_EQ(cursor.next()->mText, "b1");
+    ASSERT_TRUE(cursor.unread());
+    ASSERT_TRUE(cursor.unread());
+    ASSERT_EQ(cursor.next()->mText, "a2");
+    ASSERT_EQ(cursor.next()->mText, "b1");
+    ASSERT_EQ(cursor.next()->mText, "c1");
+
+    // The first page fell out of the window
+    ASSERT_EQ(cursor.lookbehind(2)->mText, "b1");
+    ASSERT_FALSE(cursor.lookbehind(3));
+    ASSERT_EQ(cursor.next()->mText, "c2");
+    ASSERT_FALSE(cursor.next());
+}
+
+TEST(ReportLoaderTest, LineIndex_MatchesGetlineAndTrim) {
+    // Lines and whitespace runs crossing the 16 and 32 byte blocks of the vector paths
+    std::vector<std::string> texts {"", "\n", "\n\n", "no newline", "a\nb\n", " \t\r\n\f\v x \n  "};
+    texts.push_back(std::string(31, ' ') + "\n" + std::string(33, 'x') + "\r\n" + std::string(70, ' ') + "y");
+    texts.push_back(std::string(64, '\n') + " z" + std::string(40, '\t'));
+    {
+        std::ifstream file {txtPdfData};
+        texts.emplace_back(std::istreambuf_iterator<char> {file}, std::istreambuf_iterator<char> {});
+    }
+
+    for (const auto& text : texts) {
+        std::vector<std::pair<std::string, std::string>> expected;
+        std::istringstream stream {text};
+        for (std::string line; std::getline(stream, line);) {
+            const auto begin = line.find_first_not_of(" \t\n\v\f\r");
+            const auto end = line.find_last_not_of(" \t\n\v\f\r");
+            expected.emplace_back(line, begin == std::string::npos ? "" : line.substr(begin, end - begin + 1));
+        }
+
+        for (const auto isa : {LineIndex::Isa::Scalar, LineIndex::Isa::Sse2, LineIndex::Isa::Avx2}) {
+            if (!LineIndex::supported(isa)) {
+                continue;
+            }
+            const LineIndex index {text, isa};
+            ASSERT_EQ(index.size(), expected.size()) << "Instruction set " << static_cast<int>(isa);
+            for (size_t i = 0; i < index.size(); ++i) {
+                ASSERT_EQ(index.raw(i), expected[i].first) << "Line " << i << ", instruction set " << static_cast<int>(isa);
+                ASSERT_EQ(index.text(i), expected[i].second) << "Line " << i << ", instruction set " << static_cast<int>(isa);
+            }
+        }
+    }
+}
+
+TEST(ReportLoaderTest, NumberParser_ParsesReportNumbers) {
+    using numbers::ParseStatus;
+    double value {0.0};
+    ASSERT_EQ(numbers::parseDouble("123,139.92", value), ParseStatus::Ok);
+    ASSERT_DOUBLE_EQ(value, 123139.92);
+    ASSERT_EQ(numbers::parseDouble("-0.234", value), ParseStatus::Ok);
+    ASSERT_DOUBLE_EQ(value, -0.234);
+    ASSERT_EQ(numbers::parseDouble(" +1 000.5 ", value), ParseStatus::Ok);
+    ASSERT_DOUBLE_EQ(value, 1000.5);
+
+    value = 7.0;
+    ASSERT_EQ(numbers::parseDouble("", value), ParseStatus::Empty);
+    ASSERT_EQ(numbers::parseDouble(" , ", value), ParseStatus::Empty);
+    ASSERT_EQ(numbers::parseDouble("-", value), ParseStatus::Invalid);
+    ASSERT_EQ(numbers::parseDouble("--1", value), ParseStatus::Invalid);
+    ASSERT_EQ(numbers::parseDouble("1.2.3", value), ParseStatus::Invalid);
+    ASSERT_EQ(numbers::parseDouble("12.5%", value), ParseStatus::Invalid);
+    ASSERT_EQ(numbers::parseDouble("EUR", value), ParseStatus::Invalid);
+    ASSERT_EQ(numbers::parseDouble("1e999", value), ParseStatus::OutOfRange);
+    std::string separated;
+    for (int i = 0; i < 30; ++i) {
+        separated += "111,";
+    }
+    ASSERT_EQ(numbers::parseDouble(separated + "111", value), ParseStatus::OutOfRange);
+    ASSERT_DOUBLE_EQ(value, 7.0) << "Result must be left alone on failure";
+}
+
+TEST(ReportLoaderTest, NumberParser_ParsesCents) {
+    using numbers::ParseStatus;
+    std::int64_t cents {0};
+    ASSERT_EQ(numbers::parseCents("1,234.56", cents), ParseStatus::Ok);
+    ASSERT_EQ(cents, 123456);
+    ASSERT_EQ(numbers::parseCents("-0.234", cents), ParseStatus::Ok);
+    ASSERT_EQ(cents, -23);
+    ASSERT_EQ(numbers::parseCents("0.125", cents), ParseStatus::Ok);
+    ASSERT_EQ(cents, 13);
+    ASSERT_EQ(numbers::parseCents("-2.995", cents), ParseStatus::Ok);
+    ASSERT_EQ(cents, -300);
+    ASSERT_EQ(numbers::parseCents("5.", cents), ParseStatus::Ok);
+    ASSERT_EQ(cents, 500);
+    ASSERT_EQ(numbers::parseCents(".5", cents), ParseStatus::Ok);
+    ASSERT_EQ(cents, 50);
+    ASSERT_EQ(numbers::parseCents("92233720368547758.07", cents), ParseStatus::Ok);
+    ASSERT_EQ(cents, std::numeric_limits<std::int64_t>::max());
+
+    ASSERT_EQ(numbers::parseCents("92233720368547758.08", cents), ParseStatus::OutOfRange);
+    ASSERT_EQ(numbers::parseCents(".", cents), ParseStatus::Invalid);
+    ASSERT_EQ(numbers::parseCents("1e3", cents), ParseStatus::Invalid);
+    ASSERT_EQ(numbers::parseCents("1.-5", cents), ParseStatus::Invalid);
+    ASSERT_EQ(numbers::parseCents("", cents), ParseStatus::Empty);
+}
+
+TEST(ReportLoaderTest, NumberParser_MatchesStodOnReportNumbers) {
+    // What ReportLoader::parseDouble did before: strip separators and whitespace, then std::stod
+    const auto parseWithStod = [](std::string aValue) -> std::optional<double> {
+        aValue.erase(std::remove(aValue.begin(), aValue.end(), ','), aValue.end());
+        aValue.erase(std::remove_if(aValue.begin(), aValue.end(), ::isspace), aValue.end());
+        try {
+            size_t pos;
+            const double result = std::stod(aValue, &pos);
+            if (pos == aValue.length()) {
+                return result;
+            }
+        } catch (...) {
+        }
+        return std::nullopt;
+    };
+
+    std::ifstream file {txtPdfData};
+    size_t numbersSeen {0};
+    for (std::string word; file >> word;) {
+        double value {0.0};
+        const auto expected = parseWithStod(word);
+        const auto status = numbers::parseDouble(word, value);
+        ASSERT_EQ(expected.has_value(), status == numbers::ParseStatus::Ok) << word;
+        if (expected) {
+            ASSERT_EQ(*expected, value) << word;
+            ++numbersSeen;
+        }
+    }
+    ASSERT_GT(numbersSeen, 100u);
+}
+
+// Compare a compiled line grammar with the std::regex it replaced, match and every capture group
+template <typename Grammar>
+void expectSameAsRegex(const std::string& aPattern, const std::vector<std::string>& aLines) {
+    const std::regex regex {aPattern};
+    for (const auto& line : aLines) {
+        std::smatch expected;
+        const bool regexMatched = std::regex_match(line, expected, regex);
+        const auto actual = Grammar::match(line);
+        ASSERT_EQ(regexMatched, actual.has_value()) << aPattern << "\n" << line;
+        if (!regexMatched) {
+            continue;
+        }
+        for (size_t i = 1; i < expected.size(); ++i) {
+            ASSERT_EQ(expected[i].matched, actual->matched(i)) << aPattern << "\n" << line << "\ngroup " << i;
+            ASSERT_EQ(expected[i].str(), actual->str(i)) << aPattern << "\n" << line << "\ngroup " << i;
+        }
+    }
+}
+
+// Lines of the pre-extracted report, trimmed like the parsers do
+std::vector<std::string> trimmedReportLines() {
+    std::ifstream file {txtPdfData};
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(file, line);) {
+        const auto begin = line.find_first_not_of(" \t\n\v\f\r");
+        const auto end = line.find_last_not_of(" \t\n\v\f\r");
+        lines.push_back(begin == std::string::npos ? "" : line.substr(begin, end - begin + 1));
+    }
+    return lines;
+}
+
+TEST(ReportLoaderTest, LineGrammar_MatchesRegexOnReportLines) {
+    ASSERT_TRUE(std::filesystem::exists(txtPdfData)) << "PDF TXT file does not exist: " << txtPdfData;
+
+    auto lines = trimmedReportLines();
+    // Edge cases the fixture does not cover
+    lines.insert(lines.end(), {
+        "EUR 1", "EUR 1 2", "EUR 1 -2", "EUR 1 2 3", "EUR 1 2 3 4", "EUR 1 2-3", "EUR 0.14 -0.02 0.12",
+        "Trading Buy 01.02.2024 1,234.56 1.0000", "Trading Sell 01.02.2024 -12,345,678 0.5",
+        "Trading Buy 01.02.2024 1234.56 1.0000", "Trading Buy 01.02.2024 1,23 1", "Trading Buy 01.02.2024 1. 1",
+        "Trading Buy 1.02.2024 1 1", "EUR 1 2 3 4 5 6", "EUR 1 2 3 4 5", "Gains EUR 1,000.00 -2 3",
+        "Total for Germany", "Total for 12", "Total for Germany 12.00 1.00", "Total for 12.00 1.00",
+        "Overall Total In EUR 3.1 0", "Dividend 01.02.2024 1.2", "EUR 1.0 2.0 15.00% 3.0", "EUR 1.0 2.0 15.00 3.0",
+        "US0000000000 - Some Company", "US0000000000 -Some Company", "V. Detailed Income Section", "V.",
+        "IV  Detailed Gains and Losses Section  12", "IV  Section 2 Part 3  12", "IV Title", "Client: 12345",
+        "Client:12345", "Asset Type: Bond", "Country: Germany", "Report ID: 42", "Report ID:42",
+        "Asset Type:\tBond", "Country:\tGermany", "US0000000000\t-\tSome Company", "US0000000000 -\tSome Company",
+    });
+
+    using namespace report_lines;
+    const std::string date = R"((\d{2}\.\d{2}\.\d{4}))";
+    const std::string grouped = R"((-?\d{1,3}(?:,\d{3})*(?:\.\d+)?))";
+    expectSameAsRegex<SectionLine>(R"(^([IVX]+\.)\s+(.+)$)", lines);
+    expectSameAsRegex<TocEntryLine>(R"(^\s*[IVX]+\s+(.+?)\s+(\d+)\s*$)", lines);
+    expectSameAsRegex<HeaderLine>(R"(^(Client|Period|Currency|Country):\s+(.+)$)", lines);
+    expectSameAsRegex<AssetTypeLine>(R"(^Asset Type:[ \t](.+)$)", lines);
+    expectSameAsRegex<CountryLine>(R"(^Country:[ \t](.+)$)", lines);
+    expectSameAsRegex<IsinLine>(R"(^([A-Z0-9]+)\s+-\s+(.+)$)", lines);
+    expectSameAsRegex<IncomePaymentLine>(R"(^(Interest payment|Dividend)\s+)" + date + R"(\s+([\d,.]+)\s+([\d,.]+)\s*$)", lines);
+    expectSameAsRegex<IncomeAmountLine>(R"(^EUR\s+([\d,.]+)\s+(-?[\d,.]+)?\s*([\d,.]+)?\s*$)", lines);
+    expectSameAsRegex<IncomeTotalLine>(R"(^Total for ([A-Za-z\s]+).*$)", lines);
+    expectSameAsRegex<GainsTransactionLine>(R"(^(Trading Buy|Trading Sell)\s+)" + date + R"(\s+)" + grouped + R"(\s+)" + grouped + R"(\s*$)", lines);
+    expectSameAsRegex<GainsAmountLine>("^EUR\\s+" + grouped + "\\s+" + grouped + "\\s+" + grouped + "\\s+" + grouped + "\\s+" + grouped + "\\s+" + grouped + "$", lines);
+    expectSameAsRegex<GainsTotalLine>("^(Gains|Losses)\\s+EUR\\s+" + grouped + "\\s+" + grouped + "\\s+" + grouped + "$", lines);
+    expectSameAsRegex<ReportIdLine>(R"(^Report ID:\s+(.+)$)", lines);
+    expectSameAsRegex<WithholdingCountryLine>(R"(^([A-Za-z\s]+)$)", lines);
+    expectSameAsRegex<WithholdingDividendLine>(R"(^(Dividend)\s+)" + date + R"(\s+([\d\.]+)\s*$)", lines);
+    expectSameAsRegex<WithholdingAmountLine>(R"(^EUR\s+([\d\.]+)\s+([\d\.]+)\s+([\d\.]+%)\s+([\d\.]+)\s*$)", lines);
+    expectSameAsRegex<WithholdingTotalLine>(R"(^(Total for|Overall Total In EUR)\s+([\d\.]+)\s+([\d\.]+)$)", lines);
+    expectSameAsRegex<HistoryTransactionLine>(R"(^(Trading Buy|Trading Sell)\s+)" + date + R"(\s+)" + date +
+                                              R"(\s+EUR\s+([\d\.,]+)\s+(-?[\d\.,]+)\s+([\d\.,]+)\s+([\d\.,]+)$)", lines);
+}
+
+// The classifier must pick the first grammar that matches, with the same captures, like the chain of checks it replaced
+template <typename Classifier, typename... Grammars>
+void expectSameAsSequential(const std::vector<std::string>& aLines) {
+    for (const auto& line : aLines) {
+        const auto classified = Classifier::classify(line);
+        bool found {false};
+        const auto check = [&]<typename Grammar>() {
+            if (found) {
+                return;
+            }
+            if (const auto match = Grammar::match(line)) {
+                found = true;
+                ASSERT_TRUE(classified.template is<Grammar>()) << line;
+                for (size_t i = 0; i <= Grammar::GROUPS; ++i) {
+                    ASSERT_EQ(match->matched(i), classified.matched(i)) << line << "\ngroup " << i;
+                    ASSERT_EQ((*match)[i], classified[i]) << line << "\ngroup " << i;
+                }
+            }
+        };
+        (check.template operator()<Grammars>(), ...);
+        if (!found) {
+            ASSERT_EQ(classified.mKind, Classifier::NONE) << line;
+        }
+    }
+}
+
+TEST(ReportLoaderTest, LineClassifier_MatchesSequentialChecks) {
+    ASSERT_TRUE(std::filesystem::exists(txtPdfData)) << "PDF TXT file does not exist: " << txtPdfData;
+
+    auto lines = trimmedReportLines();
+    lines.insert(lines.end(), {"", "Total for Germany", "Total for Germany 1.00 2.00", "Gains EUR 1 2 3", "IE00B4L5Y983 - iShares",
+                               "VI. Detailed Gains and Losses Section", "Report ID: 1"});
+
+    using namespace report_lines;
+    expectSameAsSequential<IncomeLines, SectionLine, IncomeTotalLine, AssetTypeLine, CountryLine, IsinLine, IncomePaymentLine>(lines);
+    expectSameAsSequential<GainsLines, SectionLine, AssetTypeLine, CountryLine, IsinLine, GainsTotalLine, GainsTransactionLine,
+                           ReportIdLine>(lines);
+    expectSameAsSequential<WithholdingLines, SectionLine, WithholdingCountryLine, IsinLine, WithholdingDividendLine,
+                           WithholdingTotalLine>(lines);
+    expectSameAsSequential<HistoryLines, SectionLine, IsinLine, HistoryTransactionLine>(lines);
+}
+
+TEST(ReportLoaderTest, GetRawPdfData_RawTextIndexesExtractedPages) {
+    if (!std::filesystem::exists(pdfPath)) {
+        GTEST_SKIP() << "Input PDF file does not exist: " << pdfPath;
+    }
+
+    for (const auto mode : {ReportLoader::ProcessingMode::InMemory, ReportLoader::ProcessingMode::Parallel}) {
+        ReportLoader loader;
+        loader.getRawPdfData(pdfPath.string(), mode);
+
+        // Pages are laid out back to back, each followed by a newline
+        const auto& arena = loader.getRawTextArena();
+        ASSERT_FALSE(arena.pages().empty());
+        size_t offset {0};
+        for (size_t i = 0; i < arena.pages().size(); ++i) {
+            ASSERT_EQ(arena.pages()[i].mOffset, offset);
+            offset += arena.page(i).size() + 1;
+        }
+        ASSERT_EQ(offset, loader.getRawText().size());
+    }
+}
+
 TEST(ReportLoaderTest, GetRawPdfData_FileBased) {
     ASSERT_TRUE(std::filesystem::exists(expectedJson)) << "Expected JSON file does not exist: " << expectedJson;
     ASSERT_TRUE(std::filesystem::exists(txtPdfData)) << "PDF TXT file does not exist: " << txtPdfData;
@@ -269,6 +1362,122 @@ TEST(ReportLoaderTest, IsParsedJsonValid) {
         }
 }
 
+TEST(ReportLoaderTest, ConvertToJson_ParallelSectionsMatchSequential) {
+    TestReportLoader sequentialLoader;
+    sequentialLoader.getRawPdfData(pdfPath.string());
+    const auto expectedJson = sequentialLoader.convertToJson();
+    ASSERT_FALSE(expectedJson["transaction_history"].empty());
+    ASSERT_EQ(expectedJson, sequentialLoader.convertToJson()) << "A second parse must not see state left by the first";
+
+    TestReportLoader parallelLoader;
+    parallelLoader.setParallelSections(true);
+    parallelLoader.getRawPdfData(pdfPath.string());
+    for (const unsigned threads : {1u, 2u, 3u, 64u}) {
+        parallelLoader.setThreadCount(threads);
+        ASSERT_EQ(expectedJson, parallelLoader.convertToJson()) << "Parsed JSON differs with " << threads << " threads";
+    }
+
+    parallelLoader.setRequiredSections({ReportLoader::ReportSection::GainsAndLosses});
+    const auto gainsOnly = parallelLoader.convertToJson();
+    ASSERT_EQ(expectedJson["gains_and_losses_section"], gainsOnly["gains_and_losses_section"]);
+    ASSERT_EQ(expectedJson["client"], gainsOnly["client"]);
+    ASSERT_TRUE(gainsOnly["income_section"].empty());
+    ASSERT_TRUE(gainsOnly["transaction_history"].empty());
+}
+
+TEST(ReportLoaderTest, ConvertToJson_ParallelPagesJoinOpenBlocks) {
+    // Gains block and history group continue on the next page, under a repeated heading without their ISIN
+    std::string data;
+    data += "Client: X\n";
+    data += "VI. Detailed Gains and Losses Section\n";
+    data += "Transaction Date Amount Rate\n";
+    data += "Asset Type: Equities\n";
+    data += "Country: Alpha\n";
+    data += "AA0000000001 - Alpha\n";
+    data += "Trading Buy 01.02.2024 2.0 1.0000\n";
+    data += "EUR 10.00 20.00 0.00 0.00 0.00 20.00\n";
+    data += "\f\n";
+    data += "VI. Detailed Gains and Losses Section\n";
+    data += "Transaction Date Amount Rate\n";
+    data += "Trading Sell 02.03.2024 2.0 1.0000\n";
+    data += "EUR 12.00 24.00 0.00 0.00 0.00 24.00\n";
+    data += "Gains EUR 4.00 0.00 4.00\n";
+    data += "VIII. History of Transactions and Corporate Actions\n";
+    data += "Transaction Date Value Date\n";
+    data += "BB0000000002 - Beta\n";
+    data += "Trading Buy 01.01.2025 02.01.2025 EUR 100.00 10.00 1000.00 50.00\n";
+    data += "\f\n";
+    data += "VIII. History of Transactions and Corporate Actions\n";
+    data += "Transaction Date Value Date\n";
+    data += "Trading Sell 03.01.2025 04.01.2025 EUR 200.00 20.00 2000.00 100.00\n";
+    data += "CC0000000003 - Gamma\n";
+    data += "Trading Buy 05.01.2025 06.01.2025 EUR 300.00 30.00 3000.00 150.00\n";
+
+    TestReportLoader sequentialLoader;
+    sequentialLoader.setRawText(data);
+    const auto expectedJson = sequentialLoader.convertToJson();
+
+    const auto& gains = expectedJson["gains_and_losses_section"];
+    ASSERT_EQ(gains.size(), 1);
+    ASSERT_EQ(gains[0]["asset_type"], "Equities");
+    ASSERT_EQ(gains[0]["transactions"].size(), 2);
+    ASSERT_EQ(gains[0]["transactions"][1]["isin"], "AA0000000001 - Alpha");
+    ASSERT_DOUBLE_EQ(gains[0]["transactions"][1]["unit_price"].get<double>(), 12.0);
+
+    const auto& history = expectedJson["transaction_history"];
+    ASSERT_EQ(history.size(), 2);
+    ASSERT_EQ(history[0]["isin"], "BB0000000002 - Beta");
+    ASSERT_EQ(history[0]["transactions"].size(), 2);
+    ASSERT_EQ(history[1]["isin"], "CC0000000003 - Gamma");
+
+    TestReportLoader parallelLoader;
+    parallelLoader.setParallelSections(true);
+    parallelLoader.setRawText(data);
+    for (const unsigned threads : {1u, 4u}) {
+        parallelLoader.setThreadCount(threads);
+        ASSERT_EQ(expectedJson, parallelLoader.convertToJson()) << "Parsed JSON differs with " << threads << " threads";
+    }
+}
+
+TEST(ReportLoaderTest, ConvertToTransactions_XmlMatchesJsonPath) {
+    const std::set<TransactionType> types {TransactionType::Equities, TransactionType::Funds};
+    TestReportLoader loader;
+    loader.getRawPdfData(pdfPath.string());
+
+    Transactions fromJson;
+    XmlGenerator::parse_json(fromJson, types, loader.convertToJson());
+    Transactions direct = loader.convertToTransactions(types);
+    ASSERT_FALSE(direct.mGains.empty());
+    ASSERT_FALSE(direct.mIncome.mDivTransactions.empty());
+    ASSERT_FALSE(direct.mIncome.mInterests.empty());
+
+    TaxPayer taxPayer {.mTaxNumber = "12345678", .mType = "FO", .mResident = true};
+    FormData formData;
+    formData.mYear = 2024;
+    auto serialize = [](const pugi::xml_document& aDoc) {
+        std::ostringstream out;
+        aDoc.save(out);
+        return out.str();
+    };
+
+    XmlGenerator generator;
+    auto kdvp = [&](Transactions& aTransactions) {
+        auto data = XmlGenerator::prepare_kdvp_data(aTransactions.mGains, formData);
+        return serialize(generator.generate_doh_kdvp_xml(data, taxPayer));
+    };
+    auto div = [&](Transactions& aTransactions) {
+        auto data = XmlGenerator::prepare_div_data(aTransactions.mIncome.mDivTransactions, formData);
+        return serialize(generator.generate_doh_div_xml(data, taxPayer));
+    };
+    auto dho = [&](Transactions& aTransactions) {
+        auto data = XmlGenerator::prepare_dho_data(aTransactions.mIncome.mInterests, formData);
+        return serialize(generator.generate_doh_dho_xml(data, taxPayer));
+    };
+    ASSERT_EQ(kdvp(fromJson), kdvp(direct));
+    ASSERT_EQ(div(fromJson), div(direct));
+    ASSERT_EQ(dho(fromJson), dho(direct));
+}
+
 TEST(ReportLoaderTest, IncomeSectionCoverage) {
     // Real PDF format with header lines and multiple countries
     std::string testData = "Client: CLIENT001\n";
@@ -379,6 +1588,8 @@ TEST(ReportLoaderTest, IncomeSection_LiquidityAndPreviousLineFallback) {
             const auto &txn = sec["transactions"][0];
             ASSERT_TRUE(txn.contains("DEPOSIT"));
             ASSERT_TRUE(txn["DEPOSIT"].get<bool>());
+            ASSERT_DOUBLE_EQ(txn["gross_income"].get<double>(), 1.234);
+            ASSERT_DOUBLE_EQ(txn["net_income"].get<double>(), 1.0);
         }
     }
     ASSERT_TRUE(found);
@@ -458,4 +1669,69 @@ TEST(ReportLoaderTest, TransactionHistory_GroupingAndLastIsinCarry) {
         }
     }
     ASSERT_TRUE(found);
-}
\ No newline at end of file
+}
+TEST(ReportLoaderTest, ReportGrammar_OverridesWording) {
+    const auto grammarDir = std::filesystem::temp_directory_path() / "edavki_report_grammar_test";
+    std::filesystem::remove_all(grammarDir);
+    std::filesystem::create_directories(grammarDir);
+    const auto writeGrammar = [&grammarDir](const std::string& aName, const std::string& aContent) {
+        const auto path = grammarDir / aName;
+        std::ofstream {path} << aContent;
+        return path;
+    };
+
+    const auto report = [](const std::string& aGains, const std::string& aAssetType, const std::string& aBuy) {
+        std::string data;
+        data += "VI. " + aGains + "\n";
+        data += "Transaction Date Units Price\n"; // Column headings, skipped by the section parsers
+        data += aAssetType + "Equities\n";
+        data += "Country: GainsLand\n";
+        data += "ZZ1111111111 - Some Asset\n";
+        data += aBuy + " 10.03.2025 100 1.2000\n";
+        data += "EUR 12.34 0.00 0.00 0.00 0.00 9.99\n";
+        data += "Trading Sell 12.03.2025 100 1.3000\n";
+        data += "EUR 13.34 0.00 0.00 0.00 0.00 1.00\n";
+        data += "Gains EUR 1.00 0.00 0.00\n";
+        data += "VIII. History of Transactions and Corporate Actions\n";
+        data += "Transaction Value Date Units\n";
+        data += "ZZ1111111111 - Some Asset\n";
+        data += aBuy + " 01.01.2025 02.01.2025 EUR 100.00 10.00 1000.00 50.00\n";
+        return data;
+    };
+
+    TestReportLoader standardLoader;
+    standardLoader.setRawText(report("Detailed Gains and Losses Section", "Asset Type: ", "Trading Buy"));
+    const auto expected = standardLoader.convertToJson();
+    ASSERT_EQ(expected["gains_and_losses_section"].size(), 1);
+
+    const auto grammarPath = writeGrammar("grammar.json", R"({"version": 1, "words": {
+        "section_gains": ["Gains and Losses"],
+        "asset_type": ["Asset Type:", "Asset class:"],
+        "trading_buy": ["Buy"]
+    }})");
+    const auto grammar = ReportGrammar::load(grammarPath);
+    ASSERT_EQ(grammar, ReportGrammar::load(grammarPath)); // Read once, then shared
+    ASSERT_TRUE(grammar->is(report_lines::words::TRADING_SELL, "Trading Sell"));
+    ASSERT_FALSE(grammar->is(report_lines::words::TRADING_BUY, "Trading Buy"));
+    ASSERT_EQ(grammar->canonical("Buy"), "Trading Buy");
+
+    TestReportLoader loader;
+    loader.setGrammar(grammar);
+    loader.setRawText(report("Gains and Losses", "Asset class: ", "Buy"));
+    ASSERT_EQ(loader.convertToJson(), expected);
+
+    // The standard wording is no longer read once replaced
+    TestReportLoader oldWording;
+    oldWording.setGrammar(grammar);
+    oldWording.setRawText(report("Detailed Gains and Losses Section", "Asset Type: ", "Trading Buy"));
+    ASSERT_NE(oldWording.convertToJson(), expected);
+
+    ASSERT_THROW(ReportGrammar::load(writeGrammar("version.json", R"({"version": 2, "words": {}})")), std::runtime_error);
+    ASSERT_THROW(ReportGrammar::load(writeGrammar("unknown.json", R"({"version": 1, "words": {"typo": ["x"]}})")), std::runtime_error);
+    ASSERT_THROW(ReportGrammar::load(writeGrammar("empty.json", R"({"version": 1, "words": {"dividend": []}})")), std::runtime_error);
+    ASSERT_THROW(ReportGrammar::load(writeGrammar("clash.json", R"({"version": 1, "words": {"trading_buy": ["Trading Sell"]}})")),
+                 std::runtime_error);
+    ASSERT_THROW(ReportGrammar::load(grammarDir / "missing.json"), std::runtime_error);
+
+    std::filesystem::remove_all(grammarDir);
+}
@@ -8,6 +8,7 @@
 #include "xml_generator.hpp"
 #include "helper.hpp"
 #include "util_xml.hpp"
+#include "lot_matcher.hpp"
 
 
 #ifndef SAVE_GENERATED_XML_FILES
@@ -117,12 +118,211 @@ TEST(XmlGenerator, ParseJson) {
 
     ASSERT_FALSE(tx.empty()) << "No transactions parsed";
 
-    ASSERT_EQ(transactions.mGains.size(), 1);
+    ASSERT_EQ(tx.securityCount(), 1);
 
-    ASSERT_TRUE(transactions.mGains.contains("AE0000000001"));
-    ASSERT_EQ(transactions.mGains["AE0000000001"][2].mDate, "2024-08-09");
-    ASSERT_EQ(transactions.mGains["AE0000000001"][2].mType, "Trading Sell");
-    ASSERT_EQ(transactions.mGains["AE0000000001"][2].mQuantity, 0.1099);
+    // Rows stay in report order until sorted
+    ASSERT_TRUE(tx.find("AE0000000001").has_value());
+    ASSERT_EQ(tx.isin(tx.securities()[2]), "AE0000000001");
+    ASSERT_EQ(format_day(tx.days()[2]).view(), "2024-08-09");
+    ASSERT_EQ(tx.types()[2], TradeType::Sell);
+    ASSERT_EQ(tx.quantities()[2], 0.1099);
+}
+
+TEST(XmlGenerator, GainTransactions_GroupedByIsinAndDate) {
+    GainTransactions tx;
+    tx.add("US0000000002", "Second", parse_day("03.02.2024"), TradeType::Sell, 1.0, 12.0);
+    tx.add("US0000000001", "First", parse_day("05.01.2024"), TradeType::Buy, 2.0, 10.0);
+    tx.add("US0000000002", "Second", parse_day("01.02.2024"), TradeType::Buy, 1.0, 11.0);
+    tx.add("US0000000002", "Second", parse_day("03.02.2024"), TradeType::Buy, 3.0, 13.0);
+    ASSERT_EQ(tx.size(), 4);
+    ASSERT_EQ(tx.securityCount(), 2);
+    ASSERT_FALSE(tx.sorted());
+    ASSERT_THROW(tx.rows(0), std::logic_error);
+
+    tx.sort();
+    ASSERT_EQ(tx.isin(0), "US0000000001");
+    ASSERT_EQ(tx.name(1), "Second");
+    ASSERT_EQ(tx.rows(0).size(), 1);
+
+    // By date, rows of the same day stay in the order they were added
+    std::vector<double> prices;
+    for (const auto row : tx.rows(1)) {
+        prices.push_back(tx.unitPrices()[row]);
+        ASSERT_EQ(tx.securities()[row], 1);
+    }
+    ASSERT_EQ(prices, (std::vector<double> {11.0, 12.0, 13.0}));
+
+}
+
+TEST(XmlGenerator, LotMatcher_MatchesSalesFifo) {
+    GainTransactions tx;
+    tx.add("US0000000001", "First", parse_day("02.01.2024"), TradeType::Buy, 10.0, 100.0);
+    tx.add("US0000000001", "First", parse_day("01.02.2024"), TradeType::Buy, 0.5, 120.0);
+    tx.add("US0000000001", "First", parse_day("01.03.2024"), TradeType::Sell, 4.0, 110.0);
+    tx.add("US0000000001", "First", parse_day("02.04.2024"), TradeType::Sell, 6.25, 130.0);
+    tx.add("US0000000002", "Second", parse_day("05.01.2024"), TradeType::Sell, 1.0, 50.0);
+    tx.add("US0000000002", "Second", parse_day("06.01.2024"), TradeType::Buy, 0.1, 40.0);
+    tx.add("US0000000002", "Second", parse_day("06.01.2024"), TradeType::Buy, 0.2, 40.0);
+    tx.add("US0000000002", "Second", parse_day("07.01.2024"), TradeType::Sell, 0.3, 45.0);
+
+    const auto lots = LotMatcher::fifo(tx);
+    ASSERT_TRUE(tx.sorted());
+
+    // The first sale takes part of the first purchase, the second the rest of it and part of the next one
+    const auto first = lots.matches(0);
+    ASSERT_EQ(first.size(), 3);
+    ASSERT_EQ(first[0].mBuyRow, 0);
+    ASSERT_EQ(first[0].mSellRow, 2);
+    ASSERT_DOUBLE_EQ(first[0].mQuantity, 4.0);
+    ASSERT_EQ(first[0].mHoldingDays, 59);
+    ASSERT_DOUBLE_EQ(first[0].mRealizedGain, 40.0);
+    ASSERT_EQ(first[1].mBuyRow, 0);
+    ASSERT_DOUBLE_EQ(first[1].mQuantity, 6.0);
+    ASSERT_DOUBLE_EQ(first[1].mRealizedGain, 180.0);
+    ASSERT_EQ(first[2].mBuyRow, 1);
+    ASSERT_DOUBLE_EQ(first[2].mQuantity, 0.25);
+    ASSERT_EQ(first[2].mHoldingDays, 61);
+    ASSERT_DOUBLE_EQ(first[2].mRealizedGain, 2.5);
+    ASSERT_DOUBLE_EQ(lots.realizedGain(0), 222.5);
+    ASSERT_DOUBLE_EQ(lots.openQuantity(0), 0.25);
+
+    // Fractional purchases add up to the sale without a leftover, the earlier sale has no lot to take from
+    ASSERT_EQ(lots.matches(1).size(), 2);
+    ASSERT_NEAR(lots.realizedGain(1), 1.5, 1e-12);
+    ASSERT_EQ(lots.openQuantity(1), 0.0);
+    ASSERT_EQ(lots.unmatched().size(), 1);
+    ASSERT_EQ(lots.unmatched()[0].mSellRow, 4);
+    ASSERT_DOUBLE_EQ(lots.unmatched()[0].mQuantity, 1.0);
+    ASSERT_EQ(lots.matches().size(), 5);
+}
+
+TEST(XmlGenerator, LotMatcher_SkipsEmptyLotsAndRoundingLeftovers) {
+    GainTransactions tx;
+    tx.add("US0000000001", "Large", parse_day("02.01.2024"), TradeType::Buy, 0.0, 90.0);
+    tx.add("US0000000001", "Large", parse_day("03.01.2024"), TradeType::Buy, 7661368.7279, 100.0);
+    tx.add("US0000000001", "Large", parse_day("01.02.2024"), TradeType::Sell, 1954178.6022, 110.0);
+    tx.add("US0000000001", "Large", parse_day("01.03.2024"), TradeType::Sell, 5707190.1257, 120.0);
+    tx.add("US0000000001", "Large", parse_day("02.04.2024"), TradeType::Buy, 1.0, 130.0);
+    tx.add("US0000000001", "Large", parse_day("03.04.2024"), TradeType::Sell, 1.0, 140.0);
+
+    // The two sales leave about 1e-9 units of the large lot from rounding, the last sale takes the new lot
+    const auto lots = LotMatcher::fifo(tx);
+    const auto matches = lots.matches(0);
+    ASSERT_EQ(matches.size(), 3);
+    ASSERT_EQ(matches[0].mBuyRow, 1);
+    ASSERT_EQ(matches[1].mBuyRow, 1);
+    ASSERT_EQ(matches[2].mBuyRow, 4);
+    ASSERT_DOUBLE_EQ(matches[2].mQuantity, 1.0);
+    ASSERT_EQ(lots.openQuantity(0), 0.0);
+    ASSERT_TRUE(lots.unmatched().empty());
+}
+
+TEST(XmlGenerator, PrepareKdvpData_SameXmlOnAnyThreadCount) {
+    // Enough securities for the parallel path, added out of ISIN order
+    GainTransactions tx;
+    const std::int32_t first_day = parse_day("02.01.2024");
+    for (int security = 0; security < 300; ++security) {
+        const auto isin = "US" + std::to_string(1'000'000'000 + (security * 7919) % 300);
+        for (int trade = 0; trade < 5; ++trade) {
+            const auto type = trade == 4 ? TradeType::Sell : TradeType::Buy;
+            tx.add(isin, "Security " + isin, first_day + security + trade * 20, type, trade + 1.0, 10.0 + security);
+        }
+    }
+
+    FormData form;
+    form.mYear = 2024;
+    TaxPayer tp {.mTaxNumber = "12345678"};
+    auto serialize = [&](unsigned aThreadCount) {
+        auto data = XmlGenerator::prepare_kdvp_data(tx, form, aThreadCount);
+        std::ostringstream out;
+        XmlGenerator{}.generate_doh_kdvp_xml(data, tp).save(out);
+        return std::make_pair(data.mItems, out.str());
+    };
+
+    const auto [serial_items, serial_xml] = serialize(1);
+    ASSERT_EQ(serial_items.size(), 300);
+    for (size_t i = 0; i < serial_items.size(); ++i) {
+        ASSERT_EQ(serial_items[i].mItemID, static_cast<int>(i) + 1);
+        ASSERT_EQ(serial_items[i].mSecurities->mISIN, std::string(tx.isin(static_cast<GainTransactions::Security>(i))));
+    }
+    for (const unsigned threads : {0u, 2u, 7u, 64u}) {
+        ASSERT_EQ(serialize(threads).second, serial_xml) << threads << " threads";
+    }
+
+    // A sale before any purchase fails the same way on every thread count
+    tx.add("US0999999999", "Sold only", first_day, TradeType::Sell, 1.0, 1.0);
+    ASSERT_THROW(XmlGenerator::prepare_kdvp_data(tx, form, 1), std::invalid_argument);
+    ASSERT_THROW(XmlGenerator::prepare_kdvp_data(tx, form, 4), std::invalid_argument);
+}
+
+TEST(XmlGenerator, PrepareKdvpData_UnmatchedSaleThrows) {
+    const std::int32_t day = parse_day("01.03.2024");
+    FormData form;
+    form.mYear = 2024;
+
+    GainTransactions sold_out;
+    sold_out.add("US0000000001", "First", day, TradeType::Buy, 1.0, 100.0);
+    sold_out.add("US0000000001", "First", day + 1, TradeType::Sell, 1.0, 110.0);
+    ASSERT_NO_THROW(XmlGenerator::prepare_kdvp_data(sold_out, form, 1));
+
+    // The purchase is sold out, nothing is left for a second sale
+    sold_out.add("US0000000001", "First", day + 2, TradeType::Sell, 1.0, 120.0);
+    ASSERT_THROW(XmlGenerator::prepare_kdvp_data(sold_out, form, 1), std::invalid_argument);
+
+    // A sale only partly covered by the open lots fails the same way
+    GainTransactions partly;
+    partly.add("US0000000001", "First", day, TradeType::Buy, 1.0, 100.0);
+    partly.add("US0000000001", "First", day + 1, TradeType::Sell, 1.5, 90.0);
+    ASSERT_EQ(LotMatcher::fifo(partly).unmatched().size(), 1);
+    ASSERT_THROW(XmlGenerator::prepare_kdvp_data(partly, form, 1), std::invalid_argument);
+}
+
+TEST(XmlGenerator, PrepareKdvpData_RepurchaseWithin30DaysOfSale) {
+    GainTransactions tx;
+    const std::int32_t day = parse_day("01.03.2024");
+    tx.add("US0000000001", "First", day, TradeType::Buy, 10.0, 100.0);
+    tx.add("US0000000001", "First", day + 29, TradeType::Sell, 1.0, 90.0);  // Bought 29 days before
+    tx.add("US0000000001", "First", day + 30, TradeType::Sell, 1.0, 90.0);  // Bought 30 days before
+    tx.add("US0000000001", "First", day + 100, TradeType::Sell, 1.0, 90.0); // Bought again 29 days after
+    tx.add("US0000000001", "First", day + 110, TradeType::Sell, 1.0, 150.0); // Gain, bought again 19 days after
+    tx.add("US0000000001", "First", day + 129, TradeType::Buy, 1.0, 80.0);
+    tx.add("US0000000001", "First", day + 200, TradeType::Sell, 1.0, 90.0); // Bought again 30 days after
+    tx.add("US0000000001", "First", day + 230, TradeType::Buy, 1.0, 80.0);
+
+    FormData form;
+    const auto data = XmlGenerator::prepare_kdvp_data(tx, form);
+    ASSERT_EQ(data.mItems.size(), 1);
+    std::vector<bool> f10;
+    for (const auto& row : data.mItems[0].mSecurities->mRows) {
+        if (row.mSale) {
+            f10.push_back(row.mSale->mF10.value());
+        }
+    }
+    ASSERT_EQ(f10, (std::vector<bool> {false, true, false, true, true}));
+}
+
+TEST(XmlGenerator, DayNumbers_ParseAndFormat) {
+    ASSERT_EQ(parse_day("01.01.1970"), 0);
+    ASSERT_EQ(parse_day("02.01.1970"), 1);
+    ASSERT_EQ(parse_day("31.12.1969"), -1);
+    ASSERT_EQ(parse_day("09.08.2024") - parse_day("10.07.2024"), 30);
+    ASSERT_EQ(format_day(parse_day("29.02.2024")).view(), "2024-02-29");
+    ASSERT_EQ(format_day(parse_day("01.01.0900")).view(), "0900-01-01");
+    ASSERT_STREQ(format_day(parse_day("31.12.9999")).c_str(), "9999-12-31");
+
+    // Every day of four centuries round trips like std::chrono formats it
+    for (std::int32_t day = parse_day("01.01.1900"); day < parse_day("01.01.2300"); ++day) {
+        const std::chrono::year_month_day ymd {std::chrono::sys_days {std::chrono::days {day}}};
+        std::ostringstream expected;
+        expected << std::setfill('0') << std::setw(4) << static_cast<int>(ymd.year()) << '-' << std::setw(2)
+                 << static_cast<unsigned>(ymd.month()) << '-' << std::setw(2) << static_cast<unsigned>(ymd.day());
+        ASSERT_EQ(format_day(day).view(), expected.str());
+    }
+
+    ASSERT_THROW(parse_day("30.02.2024"), std::runtime_error);
+    ASSERT_THROW(parse_day("2024-01-01"), std::runtime_error);
+    ASSERT_THROW(parse_day("01.01.2024 "), std::runtime_error);
+    ASSERT_THROW(parse_day(""), std::runtime_error);
 }
 
 Transactions transactions;